@@ -43,6 +43,15 @@ inline uint32_t LerpColor(uint32_t color1, uint32_t color2, float fraction)
     (int)((red2 - red1) * fraction + red1);
 }
 
+inline uint32_t BlendColor(uint32_t src, uint32_t dst)
+{
+    const uint32_t alpha = src >> 24 & 0xFF;
+    const uint32_t inv = 255 - alpha;
+    const uint32_t rb = (((src & 0x00FF00FF) * alpha + (dst & 0x00FF00FF) * inv) >> 8) & 0x00FF00FF;
+    const uint32_t g = (((src & 0x0000FF00) * alpha + (dst & 0x0000FF00) * inv) >> 8) & 0x0000FF00;
+    return 0xFF000000 | rb | g;
+}
+
 enum class DrawMode
 {
     Normal,
@@ -56,6 +65,13 @@ enum class PixelMode
     Mask
 };
 
+enum class CompositeMode
+{
+    Opaque,
+    Mask,
+    Blend
+};
+
 enum class hDirection
 {
     Norm,
@@ -68,23 +84,77 @@ enum class vDirection
     Flip
 };
 
+template <class T, std::size_t alignment> struct AlignedAllocator
+{
+    typedef T value_type;
+    template <class U> struct rebind {typedef AlignedAllocator<U, alignment> other;};
+    AlignedAllocator() = default;
+    template <class U> AlignedAllocator(const AlignedAllocator<U, alignment>&) {}
+    inline T* allocate(std::size_t n)
+    {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(alignment)));
+    }
+    inline void deallocate(T* ptr, std::size_t n)
+    {
+        ::operator delete(ptr, std::align_val_t(alignment));
+    }
+    template <class U> friend bool operator==(const AlignedAllocator&, const AlignedAllocator<U, alignment>&) {return true;}
+    template <class U> friend bool operator!=(const AlignedAllocator&, const AlignedAllocator<U, alignment>&) {return false;}
+};
+
+#define SPRITE_ALIGNMENT 64
+
+struct rect
+{
+    float sx;
+    float sy;
+    float ex;
+    float ey;
+};
+
+struct SpriteView
+{
+    DrawMode drawMode = DrawMode::Normal;
+    uint32_t* data = nullptr;
+    int width = 0, height = 0, pitch = 0;
+    SpriteView() = default;
+    SpriteView(uint32_t* data, int width, int height, int pitch, DrawMode drawMode = DrawMode::Normal);
+    SpriteView SubView(int x, int y, int w, int h);
+    SpriteView SubView(rect src);
+    inline uint32_t* Row(int y) {return data + pitch * y;}
+    void SetPixel(uint32_t color, int x, int y);
+    uint32_t GetPixel(int x, int y);
+};
+
 struct Sprite
 {
     DrawMode drawMode = DrawMode::Normal;
-    std::vector<uint32_t> data;
-    int width, height;
+    std::vector<uint32_t, AlignedAllocator<uint32_t, SPRITE_ALIGNMENT>> data;
+    int width = 0, height = 0, pitch = 0;
     Sprite() = default;
+    Sprite(int width, int height);
     Sprite(const std::string& path);
+    void Resize(int width, int height);
+    SpriteView View();
+    SpriteView SubView(int x, int y, int w, int h);
+    SpriteView SubView(rect src);
+    inline operator SpriteView() {return View();}
+    inline uint32_t* Row(int y) {return data.data() + pitch * y;}
     void SetPixel(uint32_t color, int x, int y);
     uint32_t GetPixel(int x, int y);
 };
 
-struct rect
+struct Span
 {
-    float sx;
-    float sy;
-    float ex;
-    float ey;
+    int16_t y, sx, ex;
+};
+
+struct Stamp
+{
+    std::vector<Span> spans;
+    int sx = 0, sy = 0, ex = 0, ey = 0;
+    Stamp() = default;
+    Stamp(SpriteView view, int x, int y);
 };
 
 struct vertex
@@ -102,26 +172,74 @@ struct Camera
     bool enabled = false;
 };
 
+struct Resolution
+{
+    bool dynamic = false;
+    float scale = 1.0f;
+    float minScale = 0.5f;
+    float maxScale = 1.0f;
+    float step = 0.125f;
+    float budget = 14.0f;
+    float headroom = 0.7f;
+    int settle = 30;
+    float frameTime = 0.0f;
+    float averageFrameTime = 0.0f;
+    int framesSinceChange = 0;
+    int changes = 0;
+    uint64_t lastPresent = 0;
+    uint64_t lastSubmit = 0;
+    uint64_t frameStart = 0;
+    bool hold = false;
+};
+
+struct Clip
+{
+    int sx, sy, ex, ey;
+    bool enabled = false;
+};
+
 struct Window
 {
     Camera camera;
+    Clip clip;
+    Resolution resolution;
     SDL_Window* window;
     SDL_Renderer* renderer;
     SDL_Texture* surface;
     std::string name;
     std::vector<Sprite> drawTargets;
     int currentDrawTarget;
+    int width, height;
     bool shouldClose;
+    bool headless = false;
     PixelMode pixelMode;
-    void Init(std::string name, int width, int height);
+    void Init(std::string name, int width, int height, bool headless = false);
     void CreateWindow(std::string name, int width, int height);
     void CreateRenderer();
     void CreateSurface();
     void Present();
+    void SetRenderScale(float scale);
+    void UpdateResolution();
+    int CreateRenderTarget(int width, int height);
+    void BindRenderTarget(int target);
+    void Composite(int target, int x = 0, int y = 0, CompositeMode mode = CompositeMode::Opaque);
+    void Composite(SpriteView layer, int x = 0, int y = 0, CompositeMode mode = CompositeMode::Opaque);
+    void CompositeScaled(SpriteView layer, int x, int y, float scale, CompositeMode mode);
     int GetWidth();
     int GetHeight();
     void Clear(uint32_t color);
     void SetDrawMode(DrawMode drawMode);
+    void SetClip(int sx, int sy, int ex, int ey);
+    void ResetClip();
+    v2i CameraOffset();
+    float RenderScale();
+    v2i Project(int x, int y);
+    v2f Project(v2f p);
+    rect Project(rect r);
+    Clip Viewport();
+    bool Cull(int sx, int sy, int ex, int ey);
+    void PutPixel(uint32_t color, int x, int y);
+    void DrawSpan(uint32_t color, int sx, int ex, int y);
     void SetPixel(uint32_t color, int x, int y);
     uint32_t GetPixel(int x, int y);
     void DrawLine(uint32_t color, int x0, int y0, int x1, int y1);
@@ -131,13 +249,16 @@ struct Window
     void DrawCircle(uint32_t color, int cx, int cy, int radius);
     void DrawCircleOutline(uint32_t color, int cx, int cy, int radius);
     void DrawTriangle(uint32_t color, int x1, int y1, int x2, int y2, int x3, int y3);
-    void DrawTexturedTriangle(Sprite& sprite, vertex v1, vertex v2, vertex v3);
+    void DrawTexturedTriangle(SpriteView sprite, vertex v1, vertex v2, vertex v3);
     void DrawTriangleOutline(uint32_t color, int x1, int y1, int x2, int y2, int x3, int y3);
-    void DrawSprite(Sprite& sprite, Transform& transform, hDirection hor = hDirection::Norm, vDirection ver = vDirection::Norm);
-    void DrawSprite(int x, int y, Sprite& sprite, float size = 1, hDirection hor = hDirection::Norm, vDirection ver = vDirection::Norm);
-    void DrawSprite(int x, int y, rect dst, Sprite& sprite, float size = 1, hDirection hor = hDirection::Norm, vDirection ver = vDirection::Norm);
-    void DrawSprite(rect dst, Sprite& sprite, hDirection hor = hDirection::Norm, vDirection ver = vDirection::Norm);
-    void DrawSprite(rect dst, rect src, Sprite& sprite, hDirection hor = hDirection::Norm, vDirection ver = vDirection::Norm);
+    void DrawStamp(uint32_t color, int x, int y, const Stamp& stamp);
+    void DrawPixels(const float* x, const float* y, const uint32_t* color, int count);
+    void DrawSprite(SpriteView sprite, Transform& transform, hDirection hor = hDirection::Norm, vDirection ver = vDirection::Norm);
+    void DrawSprite(int x, int y, SpriteView sprite, float size = 1, hDirection hor = hDirection::Norm, vDirection ver = vDirection::Norm);
+    void DrawSprite(int x, int y, rect dst, SpriteView sprite, float size = 1, hDirection hor = hDirection::Norm, vDirection ver = vDirection::Norm);
+    void DrawSprite(rect dst, SpriteView sprite, hDirection hor = hDirection::Norm, vDirection ver = vDirection::Norm);
+    void DrawSprite(rect dst, rect src, SpriteView sprite, hDirection hor = hDirection::Norm, vDirection ver = vDirection::Norm);
+    void BlitSprite(int x, int y, SpriteView sprite);
     void DrawCharacter(int x, int y, const char c, float size = 1, uint32_t color = 0xFF000000);
     void DrawCharacter(rect dst, const char c, uint32_t color = 0xFF000000);
     void DrawText(int x, int y, const std::string& text, float size = 1, uint32_t color = 0xFF000000);
@@ -164,6 +285,36 @@ struct Button
     ~Button() {}
 };
 
+struct SceneCache
+{
+    int target = -1;
+    uint32_t background;
+    bool invalid = true;
+    std::vector<rect> dirty;
+    std::vector<std::function<void(Window&)>> groups;
+    SceneCache() = default;
+    void Create(Window& window, int width, int height, uint32_t background);
+    int AddGroup(std::function<void(Window&)> draw);
+    void Invalidate();
+    void Invalidate(rect region);
+    void Update(Window& window);
+    void Restore(Window& window, int x = 0, int y = 0);
+    ~SceneCache() {}
+};
+
+#define TRAIL_CAPACITY 16
+
+struct Trail
+{
+    std::array<v2f, TRAIL_CAPACITY> points;
+    int head = 0, count = 0;
+    int length = 10;
+    void Push(v2f point);
+    void Clear();
+    inline v2f Point(int age) const {return points[(head - 1 - age + TRAIL_CAPACITY) % TRAIL_CAPACITY];}
+    void Draw(Window& window, uint32_t start, uint32_t end, int width = 1) const;
+};
+
 struct SpriteSheet
 {
     Sprite sprite;
@@ -171,6 +322,7 @@ struct SpriteSheet
     SpriteSheet() = default;
     SpriteSheet(const std::string& path, int cw, int ch);
     rect GetSubImage(int cx, int cy);
+    SpriteView GetCell(int cx, int cy);
     void Draw(Window& window, int x, int y, float size, int cx, int cy, hDirection hor = hDirection::Norm, vDirection ver = vDirection::Norm);
     ~SpriteSheet() {}
 };
@@ -180,21 +332,49 @@ struct SpriteSheet
 #ifdef WINDOW_H
 #undef WINDOW_H
 
+Sprite::Sprite(int width, int height)
+{
+    Resize(width, height);
+}
+
 Sprite::Sprite(const std::string& path)
 {
     SDL_Surface* image = IMG_Load(path.c_str());
     SDL_Surface* converted = SDL_ConvertSurfaceFormat(image, SDL_PIXELFORMAT_RGBA32, 0);
-    this->width = converted->w;
-    this->height = converted->h;
-    const int size = width * height;
-    data.resize(size);
-    memcpy(data.data(), converted->pixels, size*4);
+    Resize(converted->w, converted->h);
+    for(int y = 0; y < height; y++)
+        memcpy(Row(y), (uint8_t*)converted->pixels + converted->pitch * y, width * 4);
     SDL_FreeSurface(image);
     SDL_FreeSurface(converted);
     image = nullptr;
     converted = nullptr;
 }
 
+void Sprite::Resize(int width, int height)
+{
+    const int align = SPRITE_ALIGNMENT / sizeof(uint32_t);
+    this->width = width;
+    this->height = height;
+    this->pitch = (width + align - 1) / align * align;
+    data.resize(pitch * height);
+    std::fill(data.begin(), data.end(), 0);
+}
+
+SpriteView Sprite::View()
+{
+    return SpriteView(data.data(), width, height, pitch, drawMode);
+}
+
+SpriteView Sprite::SubView(int x, int y, int w, int h)
+{
+    return View().SubView(x, y, w, h);
+}
+
+SpriteView Sprite::SubView(rect src)
+{
+    return View().SubView(src);
+}
+
 void Sprite::SetPixel(uint32_t color, int x, int y)
 {
     switch(drawMode)
@@ -214,7 +394,7 @@ void Sprite::SetPixel(uint32_t color, int x, int y)
         }
         break;
     }
-    data[width * y + x] = color;
+    data[pitch * y + x] = color;
 }
 
 uint32_t Sprite::GetPixel(int x, int y)
@@ -237,16 +417,110 @@ uint32_t Sprite::GetPixel(int x, int y)
         break;
         case DrawMode::Clamp:
         {
-            x = std::clamp(x, 0, width);
-            y = std::clamp(y, 0, height);
+            x = std::clamp(x, 0, width - 1);
+            y = std::clamp(y, 0, height - 1);
+        }
+        break;
+    }
+    return data[pitch * y + x];
+}
+
+SpriteView::SpriteView(uint32_t* data, int width, int height, int pitch, DrawMode drawMode) : 
+drawMode(drawMode), data(data), width(width), height(height), pitch(pitch) {}
+
+SpriteView SpriteView::SubView(int x, int y, int w, int h)
+{
+    const int sx = std::clamp(x, 0, width);
+    const int sy = std::clamp(y, 0, height);
+    const int ex = std::clamp(x + w, sx, width);
+    const int ey = std::clamp(y + h, sy, height);
+    return SpriteView(data + pitch * sy + sx, ex - sx, ey - sy, pitch, drawMode);
+}
+
+SpriteView SpriteView::SubView(rect src)
+{
+    if(src.ex < src.sx) std::swap(src.sx, src.ex);
+    if(src.ey < src.sy) std::swap(src.sy, src.ey);
+    return SubView((int)src.sx, (int)src.sy, (int)(src.ex - src.sx), (int)(src.ey - src.sy));
+}
+
+Stamp::Stamp(SpriteView view, int x, int y)
+{
+    sx = sy = INT_MAX;
+    ex = ey = INT_MIN;
+    for(int j = 0; j < view.height; j++)
+    {
+        const uint32_t* row = view.Row(j);
+        for(int i = 0; i < view.width;)
+        {
+            if((row[i] >> 24 & 0xFF) == 0)
+            {
+                i++;
+                continue;
+            }
+            const int start = i;
+            while(i < view.width && (row[i] >> 24 & 0xFF)) i++;
+            spans.push_back({(int16_t)(j - y), (int16_t)(start - x), (int16_t)(i - x)});
+            sx = std::min(sx, start - x); ex = std::max(ex, i - x);
+            sy = std::min(sy, j - y); ey = std::max(ey, j - y + 1);
+        }
+    }
+    if(spans.empty()) sx = sy = ex = ey = 0;
+}
+
+void SpriteView::SetPixel(uint32_t color, int x, int y)
+{
+    switch(drawMode)
+    {
+        case DrawMode::Normal:
+        {
+            if(x < 0 || x >= width || y < 0 || y >= height) 
+                return;
+        }
+        break;
+        case DrawMode::Periodic:
+        {
+            x = x % width;
+            y = y % height;
+            x += (x < 0) ? width : 0;
+            y += (y < 0) ? height : 0;
+        }
+        break;
+    }
+    data[pitch * y + x] = color;
+}
+
+uint32_t SpriteView::GetPixel(int x, int y)
+{
+    switch(drawMode)
+    {
+        case DrawMode::Normal:
+        {
+            if(x < 0 || x >= width || y < 0 || y >= height) 
+                return 0x00000000;
+        }
+        break;
+        case DrawMode::Periodic:
+        {
+            x = x % width;
+            y = y % height;
+            x += (x < 0) ? width : 0;
+            y += (y < 0) ? height : 0;
+        }
+        break;
+        case DrawMode::Clamp:
+        {
+            x = std::clamp(x, 0, width - 1);
+            y = std::clamp(y, 0, height - 1);
         }
         break;
     }
-    return data[width * y + x];
+    return data[pitch * y + x];
 }
 
-void Window::Init(std::string name, int width, int height)
+void Window::Init(std::string name, int width, int height, bool headless)
 {
+    this->headless = headless;
     CreateWindow(name, width, height);
     CreateRenderer();
     CreateSurface();
@@ -254,20 +528,21 @@ void Window::Init(std::string name, int width, int height)
 
 void Window::CreateWindow(std::string name, int width, int height)
 {
-    SDL_Init(SDL_INIT_EVERYTHING);
+    SDL_Init(headless ? SDL_INIT_TIMER : SDL_INIT_EVERYTHING);
     IMG_Init(IMG_INIT_PNG | IMG_INIT_JPG);
-    Sprite drawTarget;
-    drawTarget.width = width;
-    drawTarget.height = height;
-    drawTargets.push_back(std::move(drawTarget));
+    drawTargets.push_back(Sprite(width, height));
     currentDrawTarget = 0;
-    window = SDL_CreateWindow(name.c_str(), SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, width, height, 0);
+    this->width = width;
+    this->height = height;
+    window = headless ? nullptr : SDL_CreateWindow(name.c_str(), SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, width, height, 0);
     shouldClose = false;
     pixelMode = PixelMode::Normal;
 }
 
 void Window::CreateRenderer()
 {
+    renderer = nullptr;
+    if(headless) return;
     renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_PRESENTVSYNC | SDL_RENDERER_ACCELERATED | SDL_RENDERER_TARGETTEXTURE);
     SDL_RenderSetLogicalSize(renderer, GetWidth(), GetHeight());
 }
@@ -276,36 +551,255 @@ void Window::CreateSurface()
 {
     const int w = GetWidth();
     const int h = GetHeight();
-    surface = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ABGR8888, SDL_TEXTUREACCESS_STREAMING, w, h);
-    drawTargets[currentDrawTarget].data.resize(w * h);
-    memset(drawTargets[currentDrawTarget].data.data(), 0, 4 * w * h);
+    surface = headless ? nullptr : SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ABGR8888, SDL_TEXTUREACCESS_STREAMING, w, h);
+    drawTargets[currentDrawTarget].Resize(w, h);
 }
 
 void Window::Clear(uint32_t color)
 {
-    for(int i = 0; i < GetWidth() * GetHeight(); i++)
-        drawTargets[currentDrawTarget].data[i] = color;
+    Sprite& target = drawTargets[currentDrawTarget];
+    std::fill(target.data.begin(), target.data.end(), color);
 }
 
 void Window::Present()
 {
     int pitch;
     void* buffer;
-    SDL_LockTexture(surface, NULL, &buffer, &pitch);
-    memcpy(buffer, drawTargets[currentDrawTarget].data.data(), 4 * GetWidth() * GetHeight());
-    SDL_UnlockTexture(surface);
-    SDL_RenderClear(renderer);
-    SDL_RenderCopy(renderer, surface, NULL, NULL);
-    SDL_RenderPresent(renderer);
+    Sprite& target = drawTargets[0];
+    SDL_Rect area = {0, 0, target.width, target.height};
+    if(!headless)
+    {
+        SDL_LockTexture(surface, &area, &buffer, &pitch);
+        if(pitch == target.pitch * 4)
+            memcpy(buffer, target.data.data(), 4 * target.pitch * target.height);
+        else
+            for(int y = 0; y < target.height; y++)
+                memcpy((uint8_t*)buffer + pitch * y, target.Row(y), 4 * target.width);
+        SDL_UnlockTexture(surface);
+        SDL_RenderClear(renderer);
+        SDL_RenderCopy(renderer, surface, &area, NULL);
+    }
+    const uint64_t now = SDL_GetPerformanceCounter();
+    resolution.lastSubmit = now;
+    if(resolution.lastPresent != 0)
+    {
+        resolution.frameTime = (now - std::max(resolution.lastPresent, resolution.frameStart)) * 1000.0f / SDL_GetPerformanceFrequency();
+        resolution.averageFrameTime += (resolution.frameTime - resolution.averageFrameTime) * 0.1f;
+    }
+    if(!headless)
+        SDL_RenderPresent(renderer);
+    resolution.lastPresent = SDL_GetPerformanceCounter();
+    UpdateResolution();
+}
+
+void Window::SetRenderScale(float scale)
+{
+    scale = std::clamp(scale, resolution.minScale, resolution.maxScale);
+    if(scale == resolution.scale) return;
+    resolution.scale = scale;
+    resolution.framesSinceChange = 0;
+    resolution.changes++;
+    drawTargets[0].Resize(std::max(1, (int)(width * scale)), std::max(1, (int)(height * scale)));
+}
+
+void Window::UpdateResolution()
+{
+    if(!resolution.dynamic)
+    {
+        SetRenderScale(1.0f);
+        return;
+    }
+    if(++resolution.framesSinceChange < resolution.settle) return;
+    if(resolution.averageFrameTime > resolution.budget)
+    {
+        if(!resolution.hold)
+            SetRenderScale(resolution.scale - resolution.step);
+    }
+    else if(resolution.averageFrameTime < resolution.budget * resolution.headroom && resolution.framesSinceChange >= resolution.settle * 2)
+        SetRenderScale(resolution.scale + resolution.step);
+}
+
+int Window::CreateRenderTarget(int width, int height)
+{
+    drawTargets.push_back(Sprite(width, height));
+    return drawTargets.size() - 1;
+}
+
+void Window::BindRenderTarget(int target)
+{
+    currentDrawTarget = std::clamp(target, 0, (int)drawTargets.size() - 1);
+}
+
+void Window::Composite(int target, int x, int y, CompositeMode mode)
+{
+    if(target == currentDrawTarget || target < 0 || target >= (int)drawTargets.size()) return;
+    Composite(drawTargets[target].View(), x, y, mode);
+}
+
+void Window::Composite(SpriteView layer, int x, int y, CompositeMode mode)
+{
+    const float scale = RenderScale();
+    if(scale != 1.0f)
+    {
+        CompositeScaled(layer, x, y, scale, mode);
+        return;
+    }
+    Sprite& target = drawTargets[currentDrawTarget];
+    const int sx = std::max(x, 0), sy = std::max(y, 0);
+    const int ex = std::min(x + layer.width, target.width);
+    const int ey = std::min(y + layer.height, target.height);
+    if(sx >= ex || sy >= ey) return;
+    const int count = ex - sx;
+    for(int j = sy; j < ey; j++)
+    {
+        const uint32_t* src = layer.Row(j - y) + (sx - x);
+        uint32_t* dst = target.Row(j) + sx;
+        switch(mode)
+        {
+            case CompositeMode::Opaque:
+            {
+                memcpy(dst, src, 4 * count);
+            }
+            break;
+            case CompositeMode::Mask:
+            {
+                for(int i = 0; i < count; i++)
+                    if(src[i] >> 24 & 0xFF) dst[i] = src[i];
+            }
+            break;
+            case CompositeMode::Blend:
+            {
+                for(int i = 0; i < count; i++)
+                {
+                    const uint32_t alpha = src[i] >> 24 & 0xFF;
+                    if(alpha == 0xFF) dst[i] = src[i];
+                    else if(alpha != 0) dst[i] = BlendColor(src[i], dst[i]);
+                }
+            }
+            break;
+        }
+    }
+}
+
+void Window::CompositeScaled(SpriteView layer, int x, int y, float scale, CompositeMode mode)
+{
+    Sprite& target = drawTargets[currentDrawTarget];
+    const int tx = floor(x * scale), ty = floor(y * scale);
+    const int sx = std::max(tx, 0), sy = std::max(ty, 0);
+    const int ex = std::min(tx + (int)(layer.width * scale), target.width);
+    const int ey = std::min(ty + (int)(layer.height * scale), target.height);
+    if(sx >= ex || sy >= ey) return;
+    const uint32_t step = (uint32_t)(65536.0f / scale);
+    for(int j = sy; j < ey; j++)
+    {
+        const uint32_t* src = layer.Row(std::min((int)((j - ty) / scale), layer.height - 1));
+        uint32_t* dst = target.Row(j);
+        uint32_t u = (sx - tx) * step;
+        for(int i = sx; i < ex; i++, u += step)
+        {
+            const uint32_t pixel = src[std::min((int)(u >> 16), layer.width - 1)];
+            const uint32_t alpha = pixel >> 24 & 0xFF;
+            switch(mode)
+            {
+                case CompositeMode::Opaque: dst[i] = pixel; break;
+                case CompositeMode::Mask: if(alpha) dst[i] = pixel; break;
+                case CompositeMode::Blend: if(alpha) dst[i] = alpha == 0xFF ? pixel : BlendColor(pixel, dst[i]); break;
+            }
+        }
+    }
 }
 
 void Window::SetPixel(uint32_t color, int x, int y)
+{
+    const v2i p = Project(x, y);
+    PutPixel(color, p.x, p.y);
+}
+
+void Window::PutPixel(uint32_t color, int x, int y)
+{
+    if(pixelMode == PixelMode::Mask && (color >> 24 & 0xFF) == 0) return;
+    if(clip.enabled && (x < clip.sx || x >= clip.ex || y < clip.sy || y >= clip.ey)) return;
+    drawTargets[currentDrawTarget].SetPixel(color, x, y);
+}
+
+void Window::DrawSpan(uint32_t color, int sx, int ex, int y)
 {
     if(pixelMode == PixelMode::Mask && (color >> 24 & 0xFF) == 0) return;
-    drawTargets[currentDrawTarget].SetPixel(color, 
-        x - (camera.enabled ? camera.position.x : 0),
-        y - (camera.enabled ? camera.position.y : 0)
-    );
+    Sprite& target = drawTargets[currentDrawTarget];
+    if(target.drawMode != DrawMode::Normal)
+    {
+        for(int x = sx; x < ex; x++)
+            PutPixel(color, x, y);
+        return;
+    }
+    const Clip view = Viewport();
+    if(y < view.sy || y >= view.ey) return;
+    sx = std::max(sx, view.sx);
+    ex = std::min(ex, view.ex);
+    if(sx < ex) std::fill_n(target.Row(y) + sx, ex - sx, color);
+}
+
+v2i Window::CameraOffset()
+{
+    if(!camera.enabled) return v2i(0, 0);
+    return v2i((int)floor(camera.position.x), (int)floor(camera.position.y));
+}
+
+float Window::RenderScale()
+{
+    return currentDrawTarget == 0 ? resolution.scale : 1.0f;
+}
+
+v2i Window::Project(int x, int y)
+{
+    const v2i offset = CameraOffset();
+    const float scale = RenderScale();
+    if(scale == 1.0f) return v2i(x - offset.x, y - offset.y);
+    return v2i((int)floor((x - offset.x) * scale), (int)floor((y - offset.y) * scale));
+}
+
+v2f Window::Project(v2f p)
+{
+    const v2i offset = CameraOffset();
+    return (p - v2f(offset.x, offset.y)) * RenderScale();
+}
+
+rect Window::Project(rect r)
+{
+    const v2f s = Project(v2f(r.sx, r.sy));
+    const v2f e = Project(v2f(r.ex, r.ey));
+    return {s.x, s.y, e.x, e.y};
+}
+
+Clip Window::Viewport()
+{
+    Sprite& target = drawTargets[currentDrawTarget];
+    Clip view = {0, 0, target.width, target.height, true};
+    if(clip.enabled)
+    {
+        view.sx = std::max(view.sx, clip.sx); view.sy = std::max(view.sy, clip.sy);
+        view.ex = std::min(view.ex, clip.ex); view.ey = std::min(view.ey, clip.ey);
+    }
+    return view;
+}
+
+bool Window::Cull(int sx, int sy, int ex, int ey)
+{
+    if(drawTargets[currentDrawTarget].drawMode != DrawMode::Normal) return false;
+    const Clip view = Viewport();
+    return ex <= view.sx || sx >= view.ex || ey <= view.sy || sy >= view.ey;
+}
+
+void Window::SetClip(int sx, int sy, int ex, int ey)
+{
+    if(sx > ex) std::swap(sx, ex);
+    if(sy > ey) std::swap(sy, ey);
+    clip = {sx, sy, ex, ey, true};
+}
+
+void Window::ResetClip()
+{
+    clip.enabled = false;
 }
 
 uint32_t Window::GetPixel(int x, int y)
@@ -320,16 +814,20 @@ void Window::SetDrawMode(DrawMode drawMode)
 
 int Window::GetWidth()
 {
-    return drawTargets[currentDrawTarget].width;
+    return currentDrawTarget == 0 ? width : drawTargets[currentDrawTarget].width;
 }
 
 int Window::GetHeight()
 {
-    return drawTargets[currentDrawTarget].height;
+    return currentDrawTarget == 0 ? height : drawTargets[currentDrawTarget].height;
 }
 
 void Window::DrawLine(uint32_t color, int x0, int y0, int x1, int y1)
 {
+    const v2i p0 = Project(x0, y0), p1 = Project(x1, y1);
+    x0 = p0.x; y0 = p0.y;
+    x1 = p1.x; y1 = p1.y;
+    if(Cull(std::min(x0, x1), std::min(y0, y1), std::max(x0, x1) + 1, std::max(y0, y1) + 1)) return;
     int dx = x1 - x0;
     int dy = y1 - y0;
     int absdx = abs(dx);
@@ -349,7 +847,7 @@ void Window::DrawLine(uint32_t color, int x0, int y0, int x1, int y1)
                 y = dy < 0 ? y - 1 : y + 1;
                 d = d + 2 * (absdy - absdx); 
             }
-            SetPixel(color, x, y);
+            PutPixel(color, x, y);
         }
     } 
     else 
@@ -365,7 +863,7 @@ void Window::DrawLine(uint32_t color, int x0, int y0, int x1, int y1)
                 x = dx < 0 ? x - 1 : x + 1;
                 d = d + 2 * (absdx - absdy);
             }
-            SetPixel(color, x, y);
+            PutPixel(color, x, y);
         }
     }
 }
@@ -374,9 +872,12 @@ void Window::DrawRect(uint32_t color, int sx, int sy, int ex, int ey)
 {
     if(sx > ex) std::swap(ex, sx);
     if(sy > ey) std::swap(ey, sy);
-    for(int x = sx; x < ex; x++)
-        for(int y = sy; y < ey; y++)
-            SetPixel(color, x, y);
+    const v2i s = Project(sx, sy), e = Project(ex, ey);
+    sx = s.x; sy = s.y;
+    ex = e.x; ey = e.y;
+    if(Cull(sx, sy, ex, ey)) return;
+    for(int y = sy; y < ey; y++)
+        DrawSpan(color, sx, ex, y);
 }
 
 void Window::DrawRectOutline(uint32_t color, int sx, int sy, int ex, int ey)
@@ -406,32 +907,36 @@ void Window::DrawRotatedRectOutline(uint32_t color, int sx, int sy, int ex, int
 
 void Window::DrawCircle(uint32_t color, int cx, int cy, int radius)
 {
-    auto drawLine = [&](int sx, int ex, int y)
-    {
-        for(int x = sx; x < ex; x++) 
-            SetPixel(color, x, y);
-    };
+    const v2i center = Project(cx, cy);
+    cx = center.x;
+    cy = center.y;
+    radius = radius * RenderScale();
+    if(Cull(cx - radius, cy - radius, cx + radius, cy + radius)) return;
     const int r2 = radius * radius;
     for(int py = -radius; py < radius; py++)
     {
         int px = (int)sqrt((r2 - py * py) + 0.5);
-        int y = cy + py;
-        drawLine(cx - px, cx + px, y);
+        DrawSpan(color, cx - px, cx + px, cy + py);
     }
 }
 
 void Window::DrawCircleOutline(uint32_t color, int cx, int cy, int radius)
 {
+    const v2i center = Project(cx, cy);
+    cx = center.x;
+    cy = center.y;
+    radius = radius * RenderScale();
+    if(Cull(cx - radius, cy - radius, cx + radius + 1, cy + radius + 1)) return;
     auto drawPixels = [&](int x, int y)
     {
-        SetPixel(color, cx+x, cy+y); 
-        SetPixel(color, cx-x, cy+y); 
-        SetPixel(color, cx+x, cy-y); 
-        SetPixel(color, cx-x, cy-y); 
-        SetPixel(color, cx+y, cy+x); 
-        SetPixel(color, cx-y, cy+x); 
-        SetPixel(color, cx+y, cy-x); 
-        SetPixel(color, cx-y, cy-x); 
+        PutPixel(color, cx+x, cy+y); 
+        PutPixel(color, cx-x, cy+y); 
+        PutPixel(color, cx+x, cy-y); 
+        PutPixel(color, cx-x, cy-y); 
+        PutPixel(color, cx+y, cy+x); 
+        PutPixel(color, cx-y, cy+x); 
+        PutPixel(color, cx+y, cy-x); 
+        PutPixel(color, cx-y, cy-x); 
     };
     float t1 = radius / 16;
     int x = radius, y = 0;
@@ -445,11 +950,14 @@ void Window::DrawCircleOutline(uint32_t color, int cx, int cy, int radius)
 
 void Window::DrawTriangle(uint32_t color, int x1, int y1, int x2, int y2, int x3, int y3)
 {
+    const v2i p1 = Project(x1, y1), p2 = Project(x2, y2), p3 = Project(x3, y3);
+    x1 = p1.x; x2 = p2.x; x3 = p3.x;
+    y1 = p1.y; y2 = p2.y; y3 = p3.y;
+    if(Cull(std::min({x1, x2, x3}), std::min({y1, y2, y3}), std::max({x1, x2, x3}) + 1, std::max({y1, y2, y3}) + 1)) return;
     auto drawLine = [&](int sx, int ex, int y)
     {
         if(sx > ex) std::swap(sx, ex); 
-        for(int x = sx; x < ex; x++)
-            SetPixel(color, x, y);
+        DrawSpan(color, sx, ex, y);
     };
     if(y2 < y1) 
     {
@@ -479,10 +987,15 @@ void Window::DrawTriangle(uint32_t color, int x1, int y1, int x2, int y2, int x3
     }
 }
 
-void Window::DrawTexturedTriangle(Sprite& sprite, vertex v1, vertex v2, vertex v3)
+void Window::DrawTexturedTriangle(SpriteView sprite, vertex v1, vertex v2, vertex v3)
 {
     const int w = sprite.width;
     const int h = sprite.height;
+    v1.coord = Project(v1.coord);
+    v2.coord = Project(v2.coord);
+    v3.coord = Project(v3.coord);
+    if(Cull(std::min({v1.coord.x, v2.coord.x, v3.coord.x}), std::min({v1.coord.y, v2.coord.y, v3.coord.y}),
+    std::max({v1.coord.x, v2.coord.x, v3.coord.x}) + 1, std::max({v1.coord.y, v2.coord.y, v3.coord.y}) + 1)) return;
 #if defined VERTEX_COLOR
     auto drawLine = [&](int sx, int ex, int y, float tsx, float tex, float tsy, float tey, uint32_t sc, uint32_t ec)
 #else
@@ -502,9 +1015,9 @@ void Window::DrawTexturedTriangle(Sprite& sprite, vertex v1, vertex v2, vertex v
             float v = (tsy + curr * (tey - tsy)) * h;
 #if defined VERTEX_COLOR
             uint32_t color = LerpColor(sc, ec, curr);
-            SetPixel(LerpColor(color, sprite.GetPixel((int)u, (int)v), 0.5f), x, y);
+            PutPixel(LerpColor(color, sprite.GetPixel((int)u, (int)v), 0.5f), x, y);
 #else
-            SetPixel(sprite.GetPixel((int)u, (int)v), x, y);
+            PutPixel(sprite.GetPixel((int)u, (int)v), x, y);
 #endif
             curr += dx;
         }
@@ -547,6 +1060,37 @@ void Window::DrawTexturedTriangle(Sprite& sprite, vertex v1, vertex v2, vertex v
     }
 }
 
+void Window::DrawStamp(uint32_t color, int x, int y, const Stamp& stamp)
+{
+    const v2i p = Project(x, y);
+    if(Cull(p.x + stamp.sx, p.y + stamp.sy, p.x + stamp.ex, p.y + stamp.ey)) return;
+    for(const Span& span : stamp.spans)
+        DrawSpan(color, p.x + span.sx, p.x + span.ex, p.y + span.y);
+}
+
+void Window::DrawPixels(const float* x, const float* y, const uint32_t* color, int count)
+{
+    Sprite& target = drawTargets[currentDrawTarget];
+    if(target.drawMode != DrawMode::Normal)
+    {
+        for(int i = 0; i < count; i++)
+            SetPixel(color[i], x[i], y[i]);
+        return;
+    }
+    const v2i offset = CameraOffset();
+    const float scale = RenderScale();
+    const Clip view = Viewport();
+    const bool mask = pixelMode == PixelMode::Mask;
+    for(int i = 0; i < count; i++)
+    {
+        const int px = (int)floor(((int)x[i] - offset.x) * scale);
+        const int py = (int)floor(((int)y[i] - offset.y) * scale);
+        if(px < view.sx || px >= view.ex || py < view.sy || py >= view.ey) continue;
+        if(mask && (color[i] >> 24 & 0xFF) == 0) continue;
+        target.Row(py)[px] = color[i];
+    }
+}
+
 void Window::DrawTriangleOutline(uint32_t color, int x1, int y1, int x2, int y2, int x3, int y3)
 {
     DrawLine(color, x1, y1, x2, y2);
@@ -554,13 +1098,13 @@ void Window::DrawTriangleOutline(uint32_t color, int x1, int y1, int x2, int y2,
     DrawLine(color, x2, y2, x3, y3);
 }
 
-void Window::DrawSprite(Sprite& sprite, Transform& transform, hDirection hor, vDirection ver)
+void Window::DrawSprite(SpriteView sprite, Transform& transform, hDirection hor, vDirection ver)
 {
     float ex, ey;
     float sx, sy;
     float px, py;
     transform.Forward(0.0f, 0.0f, sx, sy);
-    px = sx; py = sy;
+    px = ex = sx; py = ey = sy;
     sx = std::min(sx, px); sy = std::min(sy, py);
     ex = std::max(ex, px); ey = std::max(ey, py);
     transform.Forward((float)sprite.width, (float)sprite.height, px, py);
@@ -575,18 +1119,22 @@ void Window::DrawSprite(Sprite& sprite, Transform& transform, hDirection hor, vD
     transform.Invert();
     if (ex < sx) std::swap(ex, sx);
     if (ey < sy) std::swap(ey, sy);
-    for (float i = sx; i < ex; ++i)
-        for (float j = sy; j < ey; ++j)
+    const float scale = RenderScale();
+    const v2i offset = CameraOffset();
+    const rect area = Project(rect{sx, sy, ex, ey});
+    if(Cull(floor(area.sx), floor(area.sy), ceil(area.ex), ceil(area.ey))) return;
+    for (float i = floor(area.sx); i < area.ex; ++i)
+        for (float j = floor(area.sy); j < area.ey; ++j)
         {
             float ox, oy;
-            transform.Backward(i, j, ox, oy);
+            transform.Backward(i / scale + offset.x, j / scale + offset.y, ox, oy);
             int u = hor == hDirection::Flip ? sprite.width - ceil(ox) : floor(ox);
             int v = ver == vDirection::Flip ? sprite.height - ceil(oy) : floor(oy);
-            this->SetPixel(sprite.GetPixel(u, v), (int)i, (int)j);
+            PutPixel(sprite.GetPixel(u, v), (int)i, (int)j);
         }
 }
 
-void Window::DrawSprite(int x, int y, Sprite& sprite, float size, hDirection hor, vDirection ver)
+void Window::DrawSprite(int x, int y, SpriteView sprite, float size, hDirection hor, vDirection ver)
 {
     rect dst;
     dst.sx = x - sprite.width * size * 0.5f;
@@ -596,7 +1144,7 @@ void Window::DrawSprite(int x, int y, Sprite& sprite, float size, hDirection hor
     DrawSprite(dst, sprite, hor, ver);
 }
 
-void Window::DrawSprite(int x, int y, rect src, Sprite& sprite, float size, hDirection hor, vDirection ver)
+void Window::DrawSprite(int x, int y, rect src, SpriteView sprite, float size, hDirection hor, vDirection ver)
 {
     if(src.ex == src.sx || src.ey == src.sy) return;
     if(src.ex < src.sx) std::swap(src.ex, src.sx);
@@ -609,13 +1157,21 @@ void Window::DrawSprite(int x, int y, rect src, Sprite& sprite, float size, hDir
     DrawSprite(dst, src, sprite, hor, ver);
 }
 
-void Window::DrawSprite(rect dst, Sprite& sprite, hDirection hor, vDirection ver)
+void Window::DrawSprite(rect dst, SpriteView sprite, hDirection hor, vDirection ver)
 {
     if(dst.ex == dst.sx || dst.ey == dst.sy) return;
     if(dst.ex < dst.sx) std::swap(dst.sx, dst.ex);
     if(dst.ey < dst.sy) std::swap(dst.sy, dst.ey);
+    if(RenderScale() == 1.0f && dst.ex - dst.sx == sprite.width && dst.ey - dst.sy == sprite.height && 
+    hor == hDirection::Norm && ver == vDirection::Norm && dst.sx == (int)dst.sx && dst.sy == (int)dst.sy)
+    {
+        BlitSprite(dst.sx, dst.sy, sprite);
+        return;
+    }
+    dst = Project(dst);
     float xScale = (dst.ex - dst.sx) / sprite.width;
     float yScale = (dst.ey - dst.sy) / sprite.height;
+    if(Cull(floor(dst.sx), floor(dst.sy), ceil(dst.ex) + 1, ceil(dst.ey) + 1)) return;
     float px = hor == hDirection::Flip ? -1 : 1;
     float dx = hor == hDirection::Flip ? dst.ex : dst.sx;
     float py = ver == vDirection::Flip ? -1 : 1;
@@ -625,19 +1181,21 @@ void Window::DrawSprite(rect dst, Sprite& sprite, hDirection hor, vDirection ver
         {
             int ox = floor(x / xScale);
             int oy = floor(y / yScale);
-            this->SetPixel(sprite.GetPixel(ox, oy), (int)(dx + x * px), (int)(dy + y * py));
+            PutPixel(sprite.GetPixel(ox, oy), (int)(dx + x * px), (int)(dy + y * py));
         }
 }
 
-void Window::DrawSprite(rect dst, rect src, Sprite& sprite, hDirection hor, vDirection ver)
+void Window::DrawSprite(rect dst, rect src, SpriteView sprite, hDirection hor, vDirection ver)
 {
     if(dst.ex == dst.sx || dst.ey == dst.sy || src.ex == src.sx || src.ey == src.sy) return;
     if(dst.ex < dst.sx) std::swap(dst.sx, dst.ex);
     if(dst.ey < dst.sy) std::swap(dst.sy, dst.ey);
     if(src.ex < src.sx) std::swap(src.sx, src.ex);
     if(src.ey < src.sy) std::swap(src.sy, src.ey);
+    dst = Project(dst);
     float xScale = (dst.ex - dst.sx) / (src.ex - src.sx);
     float yScale = (dst.ey - dst.sy) / (src.ey - src.sy);
+    if(Cull(floor(dst.sx), floor(dst.sy), ceil(dst.ex) + 1, ceil(dst.ey) + 1)) return;
     float px = hor == hDirection::Flip ? -1 : 1;
     float dx = hor == hDirection::Flip ? dst.ex : dst.sx;
     float py = ver == vDirection::Flip ? -1 : 1;
@@ -647,10 +1205,47 @@ void Window::DrawSprite(rect dst, rect src, Sprite& sprite, hDirection hor, vDir
         {
             int ox = floor(x / xScale);
             int oy = floor(y / yScale);
-            this->SetPixel(sprite.GetPixel(src.sx + ox, src.sy + oy), (int)(dx + x * px), (int)(dy + y * py));
+            PutPixel(sprite.GetPixel(src.sx + ox, src.sy + oy), (int)(dx + x * px), (int)(dy + y * py));
         }
 }
 
+void Window::BlitSprite(int x, int y, SpriteView sprite)
+{
+    if(RenderScale() != 1.0f)
+    {
+        DrawSprite(rect{(float)x, (float)y, (float)(x + sprite.width), (float)(y + sprite.height)}, sprite);
+        return;
+    }
+    Sprite& target = drawTargets[currentDrawTarget];
+    if(target.drawMode != DrawMode::Normal)
+    {
+        for(int j = 0; j < sprite.height; j++)
+            for(int i = 0; i < sprite.width; i++)
+                SetPixel(sprite.Row(j)[i], x + i, y + j);
+        return;
+    }
+    const v2i offset = CameraOffset();
+    const Clip view = Viewport();
+    x -= offset.x;
+    y -= offset.y;
+    const int sx = std::max(x, view.sx), sy = std::max(y, view.sy);
+    const int ex = std::min(x + sprite.width, view.ex);
+    const int ey = std::min(y + sprite.height, view.ey);
+    if(sx >= ex || sy >= ey) return;
+    for(int j = sy; j < ey; j++)
+    {
+        const uint32_t* src = sprite.Row(j - y) + (sx - x);
+        uint32_t* dst = target.Row(j) + sx;
+        if(pixelMode == PixelMode::Mask)
+        {
+            for(int i = 0; i < ex - sx; i++)
+                if(src[i] >> 24 & 0xFF) dst[i] = src[i];
+        }
+        else
+            memcpy(dst, src, 4 * (ex - sx));
+    }
+}
+
 void Window::DrawCharacter(int x, int y, const char c, float size, uint32_t color)
 {
     rect dst;
@@ -677,8 +1272,10 @@ void Window::DrawCharacter(rect dst, const char c, uint32_t color)
     if(dst.ex == dst.sx || dst.sy == dst.ey) return;
     if(dst.ex < dst.sx) std::swap(dst.ex, dst.sx);
     if(dst.ey < dst.sy) std::swap(dst.ey, dst.sy);
+    dst = Project(dst);
     float xScale = (dst.ex - dst.sx) / FONT_WIDTH;
     float yScale = (dst.ey - dst.sy) / FONT_HEIGHT;
+    if(Cull(floor(dst.sx), floor(dst.sy), ceil(dst.ex) + 1, ceil(dst.ey) + 1)) return;
     for(float x = 0; x < dst.ex - dst.sx; x++)
         for(float y = 0; y < dst.ey - dst.sy; y++)
         {
@@ -686,7 +1283,7 @@ void Window::DrawCharacter(rect dst, const char c, uint32_t color)
             int oy = floor(y / yScale);
             if(fontData[(int)c - 32][oy] & (1 << ox))
             {
-                SetPixel(color, (int)(dst.sx + (FONT_WIDTH * xScale - x)), (int)(dst.sy + (FONT_HEIGHT * yScale - y)));        
+                PutPixel(color, (int)(dst.sx + (FONT_WIDTH * xScale - x)), (int)(dst.sy + (FONT_HEIGHT * yScale - y)));
             }
         }
 }
@@ -713,6 +1310,109 @@ void Window::DrawText(rect dst, const std::string& text, uint32_t color)
     }
 }
 
+void SceneCache::Create(Window& window, int width, int height, uint32_t background)
+{
+    this->target = window.CreateRenderTarget(width, height);
+    this->background = background;
+    Invalidate();
+}
+
+int SceneCache::AddGroup(std::function<void(Window&)> draw)
+{
+    groups.push_back(std::move(draw));
+    Invalidate();
+    return groups.size() - 1;
+}
+
+void SceneCache::Invalidate()
+{
+    invalid = true;
+    dirty.clear();
+}
+
+void SceneCache::Invalidate(rect region)
+{
+    if(invalid) return;
+    if(dirty.size() >= 32)
+    {
+        Invalidate();
+        return;
+    }
+    dirty.push_back(region);
+}
+
+void SceneCache::Update(Window& window)
+{
+    if(!invalid && dirty.empty()) return;
+    const int previous = window.currentDrawTarget;
+    const bool camera = window.camera.enabled;
+    window.BindRenderTarget(target);
+    window.camera.enabled = false;
+    if(invalid)
+    {
+        window.Clear(background);
+        for(auto& group : groups) group(window);
+    }
+    else
+    {
+        Sprite& cache = window.drawTargets[target];
+        for(auto& region : dirty)
+        {
+            const int sx = std::clamp((int)floor(std::min(region.sx, region.ex)), 0, cache.width);
+            const int sy = std::clamp((int)floor(std::min(region.sy, region.ey)), 0, cache.height);
+            const int ex = std::clamp((int)ceil(std::max(region.sx, region.ex)), sx, cache.width);
+            const int ey = std::clamp((int)ceil(std::max(region.sy, region.ey)), sy, cache.height);
+            if(sx == ex || sy == ey) continue;
+            for(int y = sy; y < ey; y++)
+                std::fill_n(cache.Row(y) + sx, ex - sx, background);
+            window.SetClip(sx, sy, ex, ey);
+            for(auto& group : groups) group(window);
+            window.ResetClip();
+        }
+    }
+    invalid = false;
+    dirty.clear();
+    window.camera.enabled = camera;
+    window.BindRenderTarget(previous);
+}
+
+void SceneCache::Restore(Window& window, int x, int y)
+{
+    Sprite& cache = window.drawTargets[target];
+    window.Composite(cache.SubView(x, y, window.GetWidth(), window.GetHeight()));
+}
+
+void Trail::Push(v2f point)
+{
+    points[head] = point;
+    head = (head + 1) % TRAIL_CAPACITY;
+    count = std::min(count + 1, std::min(length, TRAIL_CAPACITY));
+}
+
+void Trail::Clear()
+{
+    head = count = 0;
+}
+
+void Trail::Draw(Window& window, uint32_t start, uint32_t end, int width) const
+{
+    for(int i = 1; i < count; i++)
+    {
+        const float age = (float)i / (count - 1);
+        const v2f a = Point(i - 1), b = Point(i);
+        const v2f d = b - a;
+        const float length = std::hypot(d.x, d.y);
+        const v2f normal = length > 0.0f ? v2f(-d.y / length, d.x / length) : v2f(0.0f, 0.0f);
+        const uint32_t color = LerpColor(start, end, age);
+        const int lines = 1 + (int)((width - 1) * age + 0.5f);
+        for(int k = 0; k < lines; k++)
+        {
+            const v2f o = normal * (k - (lines - 1) * 0.5f);
+            window.DrawLine(color, a.x + o.x, a.y + o.y, b.x + o.x, b.y + o.y);
+        }
+    }
+}
+
 SpriteSheet::SpriteSheet(const std::string& path, int cw, int ch)
 {
     sprite = Sprite(path);
@@ -730,9 +1430,14 @@ rect SpriteSheet::GetSubImage(int cx, int cy)
     return rc;
 }
 
+SpriteView SpriteSheet::GetCell(int cx, int cy)
+{
+    return sprite.SubView(cx * cellWidth, cy * cellHeight, cellWidth, cellHeight);
+}
+
 void SpriteSheet::Draw(Window& window, int x, int y, float size, int cx, int cy, hDirection hor, vDirection ver)
 {
-    window.DrawSprite(x, y, GetSubImage(cx, cy), this->sprite, size, hor, ver);
+    window.DrawSprite(x, y, GetCell(cx, cy), size, hor, ver);
 }
 
 Button::Button(const std::string& path)
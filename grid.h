@@ -0,0 +1,113 @@
+#ifndef GRID_H
+#define GRID_H
+
+#include "includes.h"
+
+struct SpatialGrid
+{
+    float cellSize = 64.0f;
+    float inverse = 1.0f / 64.0f;
+    int columns = 1, rows = 1;
+    std::vector<v2f> positions;
+    std::vector<int> cells;
+    std::vector<int> cellStart;
+    std::vector<int> items;
+    SpatialGrid() = default;
+    void Create(float width, float height, float cellSize);
+    void Clear();
+    int Insert(v2f position);
+    void Build();
+    inline int Size() {return positions.size();}
+    inline int Column(float x) {return std::clamp((int)(x * inverse), 0, columns - 1);}
+    inline int Row(float y) {return std::clamp((int)(y * inverse), 0, rows - 1);}
+    template <class F> void QueryRect(rect area, const F& visit);
+    template <class F> void QueryRadius(v2f center, float radius, const F& visit);
+};
+
+template <class F> void SpatialGrid::QueryRect(rect area, const F& visit)
+{
+    if(area.sx > area.ex) std::swap(area.sx, area.ex);
+    if(area.sy > area.ey) std::swap(area.sy, area.ey);
+    const int sx = Column(area.sx), ex = Column(area.ex);
+    const int sy = Row(area.sy), ey = Row(area.ey);
+    for(int y = sy; y <= ey; y++)
+        for(int x = sx; x <= ex; x++)
+        {
+            const int cell = y * columns + x;
+            for(int i = cellStart[cell]; i < cellStart[cell + 1]; i++)
+            {
+                const v2f& p = positions[items[i]];
+                if(p.x > area.sx && p.x < area.ex && p.y > area.sy && p.y < area.ey)
+                    visit(items[i]);
+            }
+        }
+}
+
+template <class F> void SpatialGrid::QueryRadius(v2f center, float radius, const F& visit)
+{
+    const float r2 = radius * radius;
+    const int sx = Column(center.x - radius), ex = Column(center.x + radius);
+    const int sy = Row(center.y - radius), ey = Row(center.y + radius);
+    for(int y = sy; y <= ey; y++)
+        for(int x = sx; x <= ex; x++)
+        {
+            const int cell = y * columns + x;
+            for(int i = cellStart[cell]; i < cellStart[cell + 1]; i++)
+            {
+                const v2f d = positions[items[i]] - center;
+                const float d2 = d.x * d.x + d.y * d.y;
+                if(d2 < r2) visit(items[i], d2);
+            }
+        }
+}
+
+#endif
+
+#ifdef GRID_H
+#undef GRID_H
+
+void SpatialGrid::Create(float width, float height, float size)
+{
+    cellSize = size;
+    inverse = 1.0f / size;
+    columns = std::max(1, (int)ceil(width * inverse));
+    rows = std::max(1, (int)ceil(height * inverse));
+    cellStart.assign(columns * rows + 1, 0);
+    Clear();
+}
+
+void SpatialGrid::Clear()
+{
+    positions.clear();
+    cells.clear();
+    items.clear();
+    std::fill(cellStart.begin(), cellStart.end(), 0);
+}
+
+int SpatialGrid::Insert(v2f position)
+{
+    positions.push_back(position);
+    return positions.size() - 1;
+}
+
+void SpatialGrid::Build()
+{
+    const int count = positions.size();
+    cells.resize(count);
+    items.resize(count);
+    std::fill(cellStart.begin(), cellStart.end(), 0);
+    for(int i = 0; i < count; i++)
+    {
+        cells[i] = Row(positions[i].y) * columns + Column(positions[i].x);
+        cellStart[cells[i] + 1]++;
+    }
+    for(int c = 0; c < columns * rows; c++)
+        cellStart[c + 1] += cellStart[c];
+    for(int i = 0; i < count; i++)
+        items[cellStart[cells[i]]++] = i;
+    for(int c = columns * rows; c > 0; c--)
+        cellStart[c] = cellStart[c - 1];
+    cellStart[0] = 0;
+}
+
+#endif
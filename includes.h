@@ -4,6 +4,7 @@
 #include <SDL2/SDL_image.h>
 #include <iostream>
 #include <stdint.h>
+#include <climits>
 #include <cstring>
 #include <math.h>
 #include <cmath>
@@ -17,10 +18,23 @@
 #include <stack>
 #include <cassert>
 #include <optional>
+#include <string_view>
 #include <chrono>
+#include <new>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#if defined __AVX2__
+#include <immintrin.h>
+#endif
 #include "data.h"
 #include "math.h"
+#include "jobs.h"
 #include "graphics.h"
+#include "grid.h"
+#include "net.h"
 #include "save.h"
 
 #endif
\ No newline at end of file
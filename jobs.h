@@ -0,0 +1,235 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include "includes.h"
+
+struct JobSystem
+{
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake, done;
+    void (*task)(void*, int) = nullptr;
+    void* context = nullptr;
+    std::atomic<int> next = 0, remaining = 0;
+    int count = 0, busy = 0;
+    uint64_t generation = 0;
+    bool quit = false;
+    JobSystem() = default;
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+    void Start(int threads);
+    void Stop();
+    void Run(int size, void (*function)(void*, int), void* data);
+    template <class F> void ParallelFor(int size, int chunk, const F& body);
+    inline int Threads() {return workers.size() + 1;}
+    ~JobSystem()
+    {
+        Stop();
+    }
+private:
+    void Work();
+    void Worker();
+};
+
+struct TaskThread
+{
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake, done;
+    std::function<void()> task;
+    bool pending = false, quit = false;
+    TaskThread() = default;
+    TaskThread(const TaskThread&) = delete;
+    TaskThread& operator=(const TaskThread&) = delete;
+    void Start();
+    void Stop();
+    void Post(std::function<void()> function);
+    void Wait();
+    ~TaskThread()
+    {
+        Stop();
+    }
+private:
+    void Run();
+};
+
+template <class T, int N> struct SpscQueue
+{
+    static_assert((N & (N - 1)) == 0, "SpscQueue capacity must be a power of two");
+    std::array<T, N> items;
+    alignas(64) std::atomic<uint32_t> head = 0;
+    alignas(64) std::atomic<uint32_t> tail = 0;
+    inline bool Push(const T& item)
+    {
+        const uint32_t t = tail.load(std::memory_order_relaxed);
+        if(t - head.load(std::memory_order_acquire) == N) return false;
+        items[t & (N - 1)] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+    inline bool Pop(T& item)
+    {
+        const uint32_t h = head.load(std::memory_order_relaxed);
+        if(h == tail.load(std::memory_order_acquire)) return false;
+        item = items[h & (N - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+template <class F> void JobSystem::ParallelFor(int size, int chunk, const F& body)
+{
+    struct Range
+    {
+        const F* body;
+        int size, chunk;
+    } range = {&body, size, chunk};
+    Run((size + chunk - 1) / chunk, [](void* data, int index)
+    {
+        const Range& range = *(Range*)data;
+        const int begin = index * range.chunk;
+        (*range.body)(begin, std::min(range.size, begin + range.chunk), index);
+    }, &range);
+}
+
+#endif
+
+#ifdef JOBS_H
+#undef JOBS_H
+
+void JobSystem::Start(int threads)
+{
+    Stop();
+    quit = false;
+    for(int i = 0; i < threads; i++)
+        workers.emplace_back(&JobSystem::Worker, this);
+}
+
+void JobSystem::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wake.notify_all();
+    for(auto& worker : workers)
+        worker.join();
+    workers.clear();
+}
+
+void JobSystem::Run(int size, void (*function)(void*, int), void* data)
+{
+    if(size <= 0) return;
+    if(size == 1 || workers.empty())
+    {
+        for(int i = 0; i < size; i++)
+            function(data, i);
+        return;
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [&]{return busy == 0;});
+        task = function;
+        context = data;
+        count = size;
+        remaining = size;
+        next = 0;
+        generation++;
+    }
+    wake.notify_all();
+    Work();
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&]{return remaining == 0 && busy == 0;});
+}
+
+void JobSystem::Work()
+{
+    for(int i = next++; i < count; i = next++)
+    {
+        task(context, i);
+        remaining--;
+    }
+}
+
+void JobSystem::Worker()
+{
+    uint64_t seen = 0;
+    while(true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&]{return quit || generation != seen;});
+            if(quit) return;
+            seen = generation;
+            busy++;
+        }
+        Work();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            busy--;
+        }
+        done.notify_all();
+    }
+}
+
+void TaskThread::Start()
+{
+    if(thread.joinable()) return;
+    quit = false;
+    thread = std::thread(&TaskThread::Run, this);
+}
+
+void TaskThread::Stop()
+{
+    if(!thread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wake.notify_all();
+    thread.join();
+}
+
+void TaskThread::Post(std::function<void()> function)
+{
+    if(!thread.joinable())
+    {
+        function();
+        return;
+    }
+    Wait();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        task = std::move(function);
+        pending = true;
+    }
+    wake.notify_all();
+}
+
+void TaskThread::Wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&]{return !pending;});
+}
+
+void TaskThread::Run()
+{
+    while(true)
+    {
+        std::function<void()> function;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&]{return quit || pending;});
+            if(!pending) return;
+            function = std::move(task);
+        }
+        function();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending = false;
+        }
+        done.notify_all();
+    }
+}
+
+#endif
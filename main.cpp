@@ -16,10 +16,11 @@ struct Shape
     }
 };
 
-struct Rect : Shape
+struct Rect final : Shape
 {
     int width, height;
     v2f vertices[4];
+    bool rotated = false;
     Rect() = default;
     Rect(float x, float y, float width, float height, uint32_t color) : width(width), height(height) 
     {
@@ -31,15 +32,24 @@ struct Rect : Shape
     void Rotate(float angle) override 
     {
         currentAngle += angle;
+        rotated = currentAngle != 0;
         vertices[0] = rotate(currentAngle, v2f(-width * 0.5, -height * 0.5));
         vertices[1] = rotate(currentAngle, v2f(width * 0.5, -height * 0.5));
         vertices[2] = rotate(currentAngle, v2f(-width * 0.5, height * 0.5));
         vertices[3] = rotate(currentAngle, v2f(width * 0.5, height * 0.5));
     }
+    void Orient(v2f direction)
+    {
+        rotated = true;
+        vertices[0] = rotate(direction, v2f(-width * 0.5, -height * 0.5));
+        vertices[1] = rotate(direction, v2f(width * 0.5, -height * 0.5));
+        vertices[2] = rotate(direction, v2f(-width * 0.5, height * 0.5));
+        vertices[3] = rotate(direction, v2f(width * 0.5, height * 0.5));
+    }
     void Draw(Window& window, DrawMode drawMode = DrawMode::Normal) override
     {
         window.SetDrawMode(drawMode);
-        if(currentAngle == 0)
+        if(!rotated)
             window.DrawRect(color, position.x-width*0.5, position.y-height*0.5, position.x+width*0.5, position.y+height*0.5);
         else
         {
@@ -51,7 +61,7 @@ struct Rect : Shape
     }
 };
 
-struct Circle : Shape
+struct Circle final : Shape
 {
     int radius;
     Circle() = default;
@@ -74,9 +84,13 @@ struct Circle : Shape
     {
         return;
     }
+    void Orient(v2f direction)
+    {
+        return;
+    }
 };
 
-struct Triangle : Shape
+struct Triangle final : Shape
 {
     v2f vertices[3], currVertices[3];
     Triangle() = default;
@@ -104,6 +118,12 @@ struct Triangle : Shape
         currVertices[1] = rotate(currentAngle, vertices[1]);
         currVertices[2] = rotate(currentAngle, vertices[2]);
     }
+    void Orient(v2f direction)
+    {
+        currVertices[0] = rotate(direction, vertices[0]);
+        currVertices[1] = rotate(direction, vertices[1]);
+        currVertices[2] = rotate(direction, vertices[2]);
+    }
 };
 
 enum class pShape
@@ -126,22 +146,166 @@ enum class pBehaviour
     Directional
 };
 
-struct particle
+template <class T> using pArray = std::vector<T, AlignedAllocator<T, 64>>;
+
+struct pGroup
 {
-    uint32_t color;
-    float rotation;
-    float size;
-    float velocity;
-    float gravity;
-    float maxDistance;
-    int currentFrame = 0;
-    int maxFrame;
-    bool dead;
-    pMode mode;
+    pArray<float> x, y;
+    pArray<float> vx, vy;
+    pArray<float> sx, sy;
+    pArray<float> speed;
+    pArray<float> gravity;
+    pArray<float> range;
+    pArray<int32_t> frame;
+    pArray<int32_t> maxFrame;
+    pArray<uint8_t> dead;
+    std::vector<uint32_t> color;
+    std::vector<float> size;
+    std::vector<pShape> shape;
+    int count = 0;
+    int capacity = 0;
+    inline void Reserve(int n)
+    {
+        if(n <= capacity) return;
+        x.resize(n); y.resize(n);
+        vx.resize(n); vy.resize(n);
+        sx.resize(n); sy.resize(n);
+        speed.resize(n);
+        gravity.resize(n);
+        range.resize(n);
+        frame.resize(n);
+        maxFrame.resize(n);
+        dead.resize(n);
+        color.resize(n);
+        size.resize(n);
+        shape.resize(n);
+        capacity = n;
+    }
+    inline void Push(uint32_t c, float angle, float sz, float velocity, float g, float distance, int maxFrames, pShape sh, v2f start)
+    {
+        const int i = count++;
+        x[i] = sx[i] = start.x;
+        y[i] = sy[i] = start.y;
+        vx[i] = cos(angle) * velocity;
+        vy[i] = sin(angle) * velocity;
+        speed[i] = velocity;
+        gravity[i] = g;
+        range[i] = distance > 0.0f ? distance * distance : INFINITY;
+        frame[i] = 0;
+        maxFrame[i] = maxFrames;
+        dead[i] = 0;
+        color[i] = c;
+        size[i] = sz;
+        shape[i] = sh;
+    }
+    inline void Copy(int dst, const pGroup& from, int src)
+    {
+        x[dst] = from.x[src]; y[dst] = from.y[src];
+        vx[dst] = from.vx[src]; vy[dst] = from.vy[src];
+        sx[dst] = from.sx[src]; sy[dst] = from.sy[src];
+        speed[dst] = from.speed[src];
+        gravity[dst] = from.gravity[src];
+        range[dst] = from.range[src];
+        frame[dst] = from.frame[src];
+        maxFrame[dst] = from.maxFrame[src];
+        dead[dst] = from.dead[src];
+        color[dst] = from.color[src];
+        size[dst] = from.size[src];
+        shape[dst] = from.shape[src];
+    }
+    inline void Move(int dst, int src)
+    {
+        Copy(dst, *this, src);
+    }
+    inline void Compact()
+    {
+        for(int i = 0; i < count;)
+        {
+            if(dead[i])
+                Move(i, --count);
+            else
+                i++;
+        }
+    }
+    inline void Clear()
+    {
+        count = 0;
+    }
+};
+
+enum class pOverflow
+{
+    DropOldest,
+    DropNew,
+    Grow
+};
+
+enum class pPriority
+{
+    Gameplay,
+    Cosmetic
+};
+
+struct pEmitter
+{
+    v2f position;
     pShape shape;
-    pBehaviour behaviour;
-    v2f startPos;
-    v2f currentPos;
+    uint32_t color;
+};
+
+struct pBudget
+{
+    bool adaptive = true;
+    float level = 1.0f;
+    float minLevel = 0.25f;
+    int framesSinceChange = 0;
+    int changes = 0;
+    int live = 0;
+    float updateTime = 0.0f, drawTime = 0.0f;
+    uint64_t requested[2] = {}, spawned[2] = {};
+    inline float Emission(pPriority priority)
+    {
+        return priority == pPriority::Gameplay ? std::min(1.0f, level * 2.0f) : level;
+    }
+    inline float Lifetime(pPriority priority)
+    {
+        return priority == pPriority::Gameplay ? 1.0f : 0.5f + 0.5f * level;
+    }
+    inline float Size(pPriority priority)
+    {
+        return priority == pPriority::Gameplay ? 1.0f : 0.5f + 0.5f * level;
+    }
+    inline void SetLevel(float value)
+    {
+        value = std::clamp(value, minLevel, 1.0f);
+        if(value == level) return;
+        level = value;
+        framesSinceChange = 0;
+        changes++;
+    }
+    inline void Update(const Resolution& resolution, int count)
+    {
+        live = count;
+        if(!adaptive)
+        {
+            SetLevel(1.0f);
+            return;
+        }
+        if(++framesSinceChange < resolution.settle) return;
+        const bool hold = resolution.dynamic && resolution.scale < resolution.maxScale;
+        if(resolution.averageFrameTime > resolution.budget)
+            SetLevel(level - resolution.step);
+        else if(resolution.averageFrameTime < resolution.budget * resolution.headroom && framesSinceChange >= resolution.settle * 2 && !hold)
+            SetLevel(level + resolution.step);
+    }
+    inline bool Settled(const Resolution& resolution)
+    {
+        return !adaptive || (level <= minLevel && framesSinceChange >= resolution.settle);
+    }
+    inline uint64_t Culled(pPriority priority)
+    {
+        return requested[(int)priority] - spawned[(int)priority];
+    }
 };
 
 struct pData
@@ -164,9 +328,89 @@ auto equilateral = [](Triangle& triangle, float size)
     triangle.currVertices[2] = triangle.vertices[2] = v2f(-size * 0.5f, -m * size);
 };
 
+struct pStamps
+{
+    std::unordered_map<uint32_t, Stamp> stamps;
+    int target = -1;
+    int angles = 32;
+    inline const Stamp& Get(Window& window, pShape shape, float size, float angle)
+    {
+        const float scale = window.RenderScale();
+        const int bucket = shape == pShape::Circle ? 0 : ((int)lround(angle * angles / (2.0f * M_PI)) % angles + angles) % angles;
+        const int length = std::clamp((int)size, 0, 511);
+        const int step = std::clamp((int)(scale * 64.0f), 0, 127);
+        const uint32_t key = (uint32_t)shape << 24 | (uint32_t)step << 16 | (uint32_t)length << 5 | bucket;
+        auto it = stamps.find(key);
+        if(it != stamps.end()) return it->second;
+        return stamps[key] = Rasterize(window, shape, length, bucket * 2.0f * M_PI / angles, scale);
+    }
+    inline Stamp Rasterize(Window& window, pShape shape, int size, float angle, float scale)
+    {
+        const int r = (int)ceil(size * scale) + 2;
+        if(target < 0) target = window.CreateRenderTarget(2 * r + 1, 2 * r + 1);
+        Sprite& scratch = window.drawTargets[target];
+        if(scratch.width < 2 * r + 1) scratch.Resize(2 * r + 1, 2 * r + 1);
+        const int previous = window.currentDrawTarget;
+        const bool camera = window.camera.enabled;
+        const Clip clip = window.clip;
+        window.BindRenderTarget(target);
+        window.camera.enabled = false;
+        window.ResetClip();
+        window.Clear(0);
+        switch(shape)
+        {
+            case pShape::Rect:
+            {
+                const float h = size * 0.5f * scale;
+                const v2f v[4] = {rotate(angle, v2f(-h, -h)), rotate(angle, v2f(h, -h)), rotate(angle, v2f(-h, h)), rotate(angle, v2f(h, h))};
+                window.DrawTriangle(0xFFFFFFFF, v[0].x + r, v[0].y + r, v[1].x + r, v[1].y + r, v[2].x + r, v[2].y + r);
+                window.DrawTriangle(0xFFFFFFFF, v[1].x + r, v[1].y + r, v[2].x + r, v[2].y + r, v[3].x + r, v[3].y + r);
+            }
+            break;
+            case pShape::Circle:
+            {
+                window.DrawCircle(0xFFFFFFFF, r, r, size * scale);
+            }
+            break;
+            case pShape::Triangle:
+            {
+                Triangle triangle;
+                equilateral(triangle, size * scale);
+                triangle.Rotate(angle);
+                const v2f* v = triangle.currVertices;
+                window.DrawTriangle(0xFFFFFFFF, v[0].x + r, v[0].y + r, v[1].x + r, v[1].y + r, v[2].x + r, v[2].y + r);
+            }
+            break;
+            case pShape::Pixel:
+            {
+                window.PutPixel(0xFFFFFFFF, r, r);
+            }
+            break;
+        }
+        Stamp stamp(scratch.SubView(0, 0, 2 * r + 1, 2 * r + 1), r, r);
+        window.BindRenderTarget(previous);
+        window.camera.enabled = camera;
+        window.clip = clip;
+        return stamp;
+    }
+};
+
 struct pSystem
 {
-    std::vector<particle> particles;
+    pGroup groups[2][2], buffers[2][2];
+    std::vector<float> waveCos, waveSin;
+    std::vector<std::pair<int32_t, int32_t>> ages;
+    pStamps stamps;
+    Random random;
+    pArray<float> samples;
+    pBudget budget;
+    std::vector<int> offsets;
+    JobSystem* jobs = nullptr;
+    int chunk = 4096;
+    pArray<float> pixelX, pixelY;
+    pArray<uint32_t> pixelColor;
+    int capacity = 16384;
+    pOverflow overflow = pOverflow::DropOldest;
     bool pause = false;
     v2f position;
     pSystem() = default;
@@ -176,140 +420,404 @@ struct pSystem
         position.x = x;
         position.y = y;
     }
-    inline void Generate(pData& data, int size, pMode mode, pShape shape, pBehaviour behaviour, float gravity, float distance, int frame)
+    inline pGroup& Group(pMode mode, pBehaviour behaviour)
+    {
+        return groups[(int)mode][(int)behaviour];
+    }
+    inline pGroup& Group(int index)
+    {
+        return groups[index / 2][index % 2];
+    }
+    inline int Count()
+    {
+        int count = 0;
+        for(auto& row : groups)
+            for(auto& group : row)
+                count += group.count;
+        return count;
+    }
+    inline void Clear()
+    {
+        for(auto& row : groups)
+            for(auto& group : row)
+                group.Clear();
+    }
+    inline void SetCapacity(int size, pOverflow policy)
+    {
+        capacity = std::max(size, 1);
+        overflow = policy;
+        ages.reserve(capacity);
+        for(auto& row : groups)
+            for(auto& group : row)
+                if(group.capacity != 0)
+                    group.Reserve(capacity);
+        if(Count() > capacity) Evict(Count() - capacity);
+    }
+    inline void Evict(int size)
     {
+        ages.clear();
+        for(int g = 0; g < 4; g++)
+            for(int i = 0; i < Group(g).count; i++)
+                ages.push_back({Group(g).frame[i], i * 4 + g});
+        size = std::min(size, (int)ages.size());
+        std::nth_element(ages.begin(), ages.begin() + size, ages.end(), std::greater<std::pair<int32_t, int32_t>>());
         for(int i = 0; i < size; i++)
+            Group(ages[i].second % 4).dead[ages[i].second / 4] = 1;
+        for(auto& row : groups)
+            for(auto& group : row)
+                group.Compact();
+    }
+    inline int Reserve(int size)
+    {
+        const int live = Count();
+        if(live + size <= capacity) return size;
+        switch(overflow)
         {
-            particles.push_back({
-                data.colors[rand(0, (int)data.colors.size())],
-                rand(data.minAngle, data.maxAngle),
-                rand(data.minSize, data.maxSize),
-                rand(data.minSpeed, data.maxSpeed),
-                gravity, distance, 0, frame,
-                false, mode, shape, behaviour,
-                {
-                    rand(data.rect.sx, data.rect.ex) + position.x,
-                    rand(data.rect.sy, data.rect.ey) + position.y
-                },
-            });
-            particles.back().currentPos = particles.back().startPos;
+            case pOverflow::DropNew:
+                return std::max(capacity - live, 0);
+            case pOverflow::Grow:
+                SetCapacity(std::max(capacity * 2, live + size), overflow);
+                return size;
+            case pOverflow::DropOldest:
+                size = std::min(size, capacity);
+                Evict(std::max(live + size - capacity, capacity / 16));
+                return size;
+        }
+        return 0;
+    }
+    inline void Wave(int frames)
+    {
+        for(int i = waveCos.size(); i < frames; i++)
+        {
+            waveCos.push_back(cos(i * 0.2f));
+            waveSin.push_back(sin(i * 0.2f));
+        }
+    }
+    inline void Generate(pData& data, int size, pMode mode, pShape shape, pBehaviour behaviour, float gravity, float distance, int frame, pPriority priority = pPriority::Cosmetic)
+    {
+        const pEmitter emitter = {position, shape, 0};
+        Generate(data, &emitter, 1, size, mode, behaviour, gravity, distance, frame, priority);
+    }
+    inline void Generate(pData& data, const pEmitter* emitters, int count, int size, pMode mode, pBehaviour behaviour, float gravity, float distance, int frame, pPriority priority = pPriority::Cosmetic)
+    {
+        if(count <= 0) return;
+        pGroup& group = Group(mode, behaviour);
+        const float emission = budget.Emission(priority);
+        const float scale = budget.Size(priority);
+        size *= count;
+        budget.requested[(int)priority] += size;
+        if(emission < 1.0f) size = (int)(size * emission + random.Float());
+        frame = std::max(1, (int)(frame * budget.Lifetime(priority)));
+        if(behaviour == pBehaviour::Sinusoidal) Wave(frame + 2);
+        size = Reserve(size);
+        budget.spawned[(int)priority] += size;
+        group.Reserve(capacity);
+        if(samples.size() < (size_t)(6 * size)) samples.resize(6 * size);
+        float* colors = samples.data();
+        float* angles = colors + size;
+        float* sizes = angles + size;
+        float* speeds = sizes + size;
+        float* xs = speeds + size;
+        float* ys = xs + size;
+        const int palette = data.colors.size();
+        random.Fill(colors, size, 0.0f, (float)palette);
+        random.Fill(angles, size, data.minAngle, data.maxAngle);
+        random.Fill(sizes, size, data.minSize * scale, data.maxSize * scale);
+        random.Fill(speeds, size, data.minSpeed, data.maxSpeed);
+        random.Fill(xs, size, data.rect.sx, data.rect.ex);
+        random.Fill(ys, size, data.rect.sy, data.rect.ey);
+        for(int i = 0; i < size; i++)
+        {
+            const pEmitter& emitter = emitters[(int64_t)i * count / size];
+            const uint32_t color = emitter.color ? emitter.color : data.colors[std::min((int)colors[i], palette - 1)];
+            group.Push(color, angles[i], sizes[i], speeds[i], gravity, distance, frame, emitter.shape, emitter.position + v2f(xs[i], ys[i]));
+        }
+    }
+    template <class F> inline void ForEachChunk(int size, const F& body)
+    {
+        if(jobs)
+            jobs->ParallelFor(size, chunk, body);
+        else
+            for(int c = 0; c * chunk < size; c++)
+                body(c * chunk, std::min(size, (c + 1) * chunk), c);
+    }
+    inline void UpdateNormal(pGroup& g, bool wave, int begin, int end)
+    {
+        int i = begin;
+#if defined __AVX2__
+        const __m256i one = _mm256_set1_epi32(1);
+        for(; i + 8 <= end; i += 8)
+        {
+            __m256 x = _mm256_load_ps(&g.x[i]);
+            __m256 y = _mm256_load_ps(&g.y[i]);
+            __m256i frame = _mm256_load_si256((const __m256i*)&g.frame[i]);
+            __m256i dead = _mm256_cmpgt_epi32(frame, _mm256_load_si256((const __m256i*)&g.maxFrame[i]));
+            x = _mm256_add_ps(x, _mm256_load_ps(&g.vx[i]));
+            y = _mm256_add_ps(y, _mm256_load_ps(&g.vy[i]));
+            if(wave)
+            {
+                const __m256 speed = _mm256_load_ps(&g.speed[i]);
+                x = _mm256_add_ps(x, _mm256_mul_ps(_mm256_i32gather_ps(waveCos.data(), frame, 4), speed));
+                y = _mm256_add_ps(y, _mm256_mul_ps(_mm256_i32gather_ps(waveSin.data(), frame, 4), speed));
+            }
+            frame = _mm256_add_epi32(frame, one);
+            const __m256 dx = _mm256_sub_ps(x, _mm256_load_ps(&g.sx[i]));
+            const __m256 dy = _mm256_sub_ps(y, _mm256_load_ps(&g.sy[i]));
+            const __m256 dist = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+            dead = _mm256_or_si256(dead, _mm256_castps_si256(_mm256_cmp_ps(dist, _mm256_load_ps(&g.range[i]), _CMP_GT_OQ)));
+            y = _mm256_add_ps(y, _mm256_load_ps(&g.gravity[i]));
+            _mm256_store_ps(&g.x[i], x);
+            _mm256_store_ps(&g.y[i], y);
+            _mm256_store_si256((__m256i*)&g.frame[i], frame);
+            const int mask = _mm256_movemask_ps(_mm256_castsi256_ps(dead));
+            for(int k = 0; k < 8; k++)
+                g.dead[i + k] = mask >> k & 1;
+        }
+#endif
+        for(; i < end; i++)
+        {
+            bool dead = g.frame[i] > g.maxFrame[i];
+            float x = g.x[i] + g.vx[i];
+            float y = g.y[i] + g.vy[i];
+            if(wave)
+            {
+                x += waveCos[g.frame[i]] * g.speed[i];
+                y += waveSin[g.frame[i]] * g.speed[i];
+            }
+            g.frame[i]++;
+            const float dx = x - g.sx[i];
+            const float dy = y - g.sy[i];
+            dead |= dx * dx + dy * dy > g.range[i];
+            g.x[i] = x;
+            g.y[i] = y + g.gravity[i];
+            g.dead[i] = dead;
+        }
+    }
+    inline void UpdateReplay(pGroup& g, bool wave, int replayAmount, int begin, int end)
+    {
+        for(int i = begin; i < end; i++)
+        {
+            const bool bounded = g.range[i] != INFINITY;
+            if(!bounded && g.frame[i] % g.maxFrame[i] == 0)
+            {
+                g.x[i] = g.sx[i];
+                g.y[i] = g.sy[i];
+            }
+            g.dead[i] = g.frame[i] == g.maxFrame[i] * replayAmount;
+            g.x[i] += g.vx[i];
+            g.y[i] += g.vy[i];
+            if(wave)
+            {
+                g.x[i] += cos(g.frame[i] * 0.2f) * g.speed[i];
+                g.y[i] += sin(g.frame[i] * 0.2f) * g.speed[i];
+            }
+            g.frame[i]++;
+            const float dx = g.x[i] - g.sx[i];
+            const float dy = g.y[i] - g.sy[i];
+            if(bounded && dx * dx + dy * dy > g.range[i])
+            {
+                g.x[i] = g.sx[i];
+                g.y[i] = g.sy[i];
+            }
+            g.y[i] += g.gravity[i];
         }
     }
     inline void Update(int replayAmount)
     {
         if(pause) return;
-        for(auto& p : particles)
-        {
-            switch(p.mode)
+        const uint64_t start = SDL_GetPerformanceCounter();
+        for(int m = 0; m < 2; m++)
+            for(int b = 0; b < 2; b++)
             {
-                case pMode::Replay:
+                pGroup& g = groups[m][b];
+                pGroup& out = buffers[m][b];
+                if(g.count == 0) continue;
+                const bool wave = (pBehaviour)b == pBehaviour::Sinusoidal;
+                offsets.resize((g.count + chunk - 1) / chunk);
+                ForEachChunk(g.count, [&](int begin, int end, int c)
                 {
-                    if(p.maxDistance <= 0.0f && p.currentFrame % p.maxFrame == 0)
-                        p.currentPos = p.startPos;
-                    p.dead = (p.currentFrame == p.maxFrame * replayAmount);
-                }
-                break;
-                case pMode::Normal:
+                    if((pMode)m == pMode::Normal)
+                        UpdateNormal(g, wave, begin, end);
+                    else
+                        UpdateReplay(g, wave, replayAmount, begin, end);
+                    int alive = 0;
+                    for(int i = begin; i < end; i++)
+                        alive += !g.dead[i];
+                    offsets[c] = alive;
+                });
+                int total = 0;
+                for(int& offset : offsets)
                 {
-                    p.dead = p.currentFrame > p.maxFrame;
+                    const int alive = offset;
+                    offset = total;
+                    total += alive;
                 }
-                break;
+                out.Reserve(g.capacity);
+                ForEachChunk(g.count, [&](int begin, int end, int c)
+                {
+                    int o = offsets[c];
+                    for(int i = begin; i < end; i++)
+                        if(!g.dead[i]) out.Copy(o++, g, i);
+                });
+                out.count = total;
+                std::swap(g, out);
             }
-
-            switch(p.behaviour)
+        budget.updateTime = (SDL_GetPerformanceCounter() - start) * 1000.0f / SDL_GetPerformanceFrequency();
+    }
+    inline void Draw(Window& window, DrawMode drawMode = DrawMode::Normal)
+    {
+        if(pause) return;
+        const uint64_t start = SDL_GetPerformanceCounter();
+        window.SetDrawMode(drawMode);
+        int pixels = 0;
+        for(auto& row : groups)
+            for(auto& g : row)
             {
-                case pBehaviour::Directional:
+                if(pixelX.size() < (size_t)(pixels + g.count))
                 {
-                    p.currentPos.x += cos(p.rotation) * p.velocity;
-                    p.currentPos.y += sin(p.rotation) * p.velocity;
+                    pixelX.resize(pixels + g.count);
+                    pixelY.resize(pixels + g.count);
+                    pixelColor.resize(pixels + g.count);
                 }
-                break;
-                case pBehaviour::Sinusoidal:
+                for(int i = 0; i < g.count; i++)
                 {
-                    p.currentPos.x += cos(p.rotation) * p.velocity;
-                    p.currentPos.y += sin(p.rotation) * p.velocity;
-                    p.currentPos.x += cos(p.currentFrame * 0.2f) * p.velocity;
-                    p.currentPos.y += sin(p.currentFrame * 0.2f) * p.velocity;
+                    if(g.shape[i] == pShape::Pixel)
+                    {
+                        pixelX[pixels] = g.x[i];
+                        pixelY[pixels] = g.y[i];
+                        pixelColor[pixels++] = g.color[i];
+                        continue;
+                    }
+                    window.DrawStamp(g.color[i], g.x[i], g.y[i], stamps.Get(window, g.shape[i], g.size[i], g.speed[i]));
                 }
-                break;
             }
+        window.DrawPixels(pixelX.data(), pixelY.data(), pixelColor.data(), pixels);
+        budget.drawTime = (SDL_GetPerformanceCounter() - start) * 1000.0f / SDL_GetPerformanceFrequency();
+    }
+};
 
-            p.currentFrame++;
+struct Mouse
+{
+    uint32_t buttons;
+    int x, y;
+};
 
-            float x = p.currentPos.x - p.startPos.x;
-            float y = p.currentPos.y - p.startPos.y;
+struct Input
+{
+    std::array<uint8_t, SDL_NUM_SCANCODES> keys;
+    Mouse mouse;
+    v2f aim;
+};
 
-            if(p.maxDistance > 0.0f && std::hypot(x, y) > p.maxDistance)
-            {
-                if(p.mode != pMode::Normal)
-                    p.currentPos = p.startPos;
-                else
-                    p.dead = true;
-            }   
-                          
-            p.currentPos.y += p.gravity;
-        }
+struct InputFrame
+{
+    uint16_t keys;
+    uint16_t steps;
+    uint32_t buttons;
+    float aimX, aimY;
+};
 
-        particles.erase(std::remove_if(particles.begin(), particles.end(), [&](particle& p){return p.dead;}), particles.end());
+struct InputLog
+{
+    static constexpr uint32_t magic = 0x4E495153;
+    static constexpr int tracked[] = {SDL_SCANCODE_W, SDL_SCANCODE_A, SDL_SCANCODE_S, SDL_SCANCODE_D};
+    uint64_t seed = 0;
+    int32_t enemies = 0;
+    std::vector<InputFrame> frames;
+    static inline InputFrame Capture(const Input& input, int steps)
+    {
+        InputFrame frame = {0, (uint16_t)steps, input.mouse.buttons, input.aim.x, input.aim.y};
+        for(int i = 0; i < 4; i++)
+            if(input.keys[tracked[i]]) frame.keys |= 1 << i;
+        return frame;
     }
-    inline void Draw(Window& window, DrawMode drawMode = DrawMode::Normal)
+    inline void Record(const Input& input, int steps)
     {
-        if(!pause)
-            for(auto& p : particles)
-                switch(p.shape)
-                {
-                    case pShape::Rect:
-                    {
-                        Rect rect;
-                        rect.color = p.color;
-                        rect.height = rect.width = p.size;
-                        rect.position.x = p.currentPos.x;
-                        rect.position.y = p.currentPos.y;
-                        rect.Rotate(p.velocity);
-                        rect.Draw(window, drawMode);
-                    }
-                    break;
-                    case pShape::Circle:
-                    {
-                        Circle circle;
-                        circle.color = p.color;
-                        circle.radius = p.size;
-                        circle.position.x = p.currentPos.x;
-                        circle.position.y = p.currentPos.y;
-                        circle.Draw(window, drawMode);
-                    }
-                    break;
-                    case pShape::Triangle:
-                    {
-                        Triangle triangle;
-                        triangle.color = p.color;
-                        triangle.position.x = p.currentPos.x;
-                        triangle.position.y = p.currentPos.y;
-                        equilateral(triangle, p.size);
-                        triangle.Rotate(p.velocity);
-                        triangle.Draw(window, drawMode);
-                    }
-                    case pShape::Pixel: 
-                    {
-                        window.SetPixel(p.color, p.currentPos.x, p.currentPos.y);
-                    }
-                    break;
-                }
+        frames.push_back(Capture(input, steps));
+    }
+    static inline void Apply(const InputFrame& frame, Input& input)
+    {
+        input.keys.fill(0);
+        for(int i = 0; i < 4; i++)
+            input.keys[tracked[i]] = (frame.keys >> i) & 1;
+        input.mouse = {frame.buttons, 0, 0};
+        input.aim = v2f(frame.aimX, frame.aimY);
+    }
+    inline bool Save(const std::string& file)
+    {
+        std::ofstream output(file.c_str(), std::ios::binary | std::ios::trunc);
+        const uint32_t count = frames.size();
+        output.write((const char*)&magic, sizeof(magic));
+        output.write((const char*)&seed, sizeof(seed));
+        output.write((const char*)&enemies, sizeof(enemies));
+        output.write((const char*)&count, sizeof(count));
+        output.write((const char*)frames.data(), count * sizeof(InputFrame));
+        return output.good();
+    }
+    inline bool Load(const std::string& file)
+    {
+        std::ifstream input(file.c_str(), std::ios::binary);
+        uint32_t header = 0, count = 0;
+        input.read((char*)&header, sizeof(header));
+        input.read((char*)&seed, sizeof(seed));
+        input.read((char*)&enemies, sizeof(enemies));
+        input.read((char*)&count, sizeof(count));
+        if(!input || header != magic) return false;
+        frames.resize(count);
+        input.read((char*)frames.data(), count * sizeof(InputFrame));
+        return input.good();
     }
 };
 
-struct Mouse
+struct Timestep
 {
-    uint32_t buttons;
-    int x, y;
+    double step = 1.0 / 60.0;
+    double accumulator = 0.0;
+    int maxSteps = 5;
+    bool threaded = false;
+    uint64_t last = 0;
+    float alpha = 0.0f;
+    int steps = 0;
+    uint64_t dropped = 0;
+    float interval = 0.0f, averageInterval = 0.0f, jitter = 0.0f;
+    float simTime = 0.0f;
+    inline void Reset()
+    {
+        last = 0;
+        accumulator = 0.0;
+    }
+    inline int Advance()
+    {
+        const uint64_t now = SDL_GetPerformanceCounter();
+        if(last == 0)
+        {
+            last = now;
+            accumulator = step;
+        }
+        const double elapsed = (double)(now - last) / SDL_GetPerformanceFrequency();
+        last = now;
+        interval = elapsed * 1000.0;
+        averageInterval += (interval - averageInterval) * 0.1f;
+        jitter += (fabs(interval - averageInterval) - jitter) * 0.1f;
+        accumulator += elapsed;
+        steps = std::min((int)(accumulator / step), maxSteps);
+        accumulator -= steps * step;
+        if(accumulator >= step)
+        {
+            dropped += (uint64_t)(accumulator / step);
+            accumulator = fmod(accumulator, step);
+        }
+        alpha = accumulator / step;
+        return steps;
+    }
 };
 
 inline void TakeScreenShot(Window& window, const std::string& file)
 {
-    const int w = window.GetWidth();
-    const int h = window.GetHeight();
-    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_ABGR8888);
-    memcpy(surface->pixels, window.drawTargets[window.currentDrawTarget].data.data(), 4*w*h);
+    Sprite& target = window.drawTargets[0];
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, target.width, target.height, 32, SDL_PIXELFORMAT_ABGR8888);
+    for(int y = 0; y < target.height; y++)
+        memcpy((uint8_t*)surface->pixels + surface->pitch * y, target.Row(y), 4 * target.width);
     IMG_SavePNG(surface, file.c_str());
     SDL_FreeSurface(surface);
 }
@@ -321,91 +829,2058 @@ struct Captures
     std::string dir;
 };
 
-struct Enemy
+struct Idle
 {
-    float velocity;
-    Shape* shape;
-    float health;
-    bool remove;
-    int cooldown;
-    pShape data;
+    bool enabled = true;
+    int timeout = 100;
+    uint32_t key = UINT32_MAX;
+    uint64_t drawn = 0, skipped = 0;
+    double drawTime = 0.0, sleepTime = 0.0;
 };
 
-struct Player
+struct Latch
 {
-    float velocity;
-    Rect rect;
-    int health;
-    int cooldown;
+    bool enabled = true;
+    float margin = 2.0f;
+    float interval = 1000.0f / 60.0f, work = 0.0f;
+    uint64_t sampled = 0, since = 0, previous = 0;
+    SpscQueue<uint32_t, 256> queue;
+    std::atomic<uint64_t> dropped = 0;
+    uint64_t frames = 0, events = 0, missed = 0;
+    int pending = 0;
+    double latency = 0.0, sampleLatency = 0.0, slept = 0.0;
+    float worst = 0.0f;
+    static int Watch(void* data, SDL_Event* e)
+    {
+        switch(e->type)
+        {
+            case SDL_KEYDOWN: case SDL_KEYUP: case SDL_MOUSEMOTION: case SDL_MOUSEBUTTONDOWN: case SDL_MOUSEBUTTONUP:
+            {
+                Latch& latch = *(Latch*)data;
+                if(!latch.queue.Push(e->type))
+                    latch.dropped++;
+            }
+            break;
+        }
+        return 0;
+    }
+    inline void Wait(const Resolution& resolution)
+    {
+        if(!enabled || resolution.lastPresent == 0) return;
+        const uint64_t frequency = SDL_GetPerformanceFrequency();
+        const uint64_t target = resolution.lastPresent + (uint64_t)(std::max(interval - work - margin, 0.0f) * frequency / 1000.0f);
+        const uint64_t now = SDL_GetPerformanceCounter();
+        if(target <= now + frequency / 1000) return;
+        SDL_Delay((target - now) * 1000 / frequency);
+        slept += (double)(SDL_GetPerformanceCounter() - now) / frequency;
+    }
+    inline void Sample()
+    {
+        const uint64_t now = SDL_GetPerformanceCounter();
+        since = sampled ? sampled : now;
+        sampled = now;
+        pending = 0;
+        uint32_t type;
+        while(queue.Pop(type))
+            pending++;
+    }
+    inline void Presented(const Resolution& resolution)
+    {
+        const float frequency = SDL_GetPerformanceFrequency() / 1000.0f;
+        const float sample = (resolution.lastSubmit - sampled) / frequency;
+        work = std::max(sample, work + (sample - work) * 0.05f);
+        const float period = (resolution.lastPresent - previous) / frequency;
+        if(previous != 0 && period < interval * 1.5f)
+            interval += (period - interval) * 0.05f;
+        else if(previous != 0)
+            missed++;
+        previous = resolution.lastPresent;
+        const double age = (resolution.lastPresent - sampled) / frequency;
+        sampleLatency += age;
+        frames++;
+        if(pending == 0) return;
+        const float bound = (resolution.lastPresent - since) / frequency;
+        latency += pending * bound;
+        worst = std::max(worst, bound);
+        events += pending;
+    }
 };
 
-struct Missile
+struct Enemy
 {
     float velocity;
-    Triangle triangle;
-    float angle;
-    float distance_current;
-    float distance_max;
+    float health;
     bool remove;
+    int cooldown;
+    pShape data;
+    bool inRange = false;
+    v2f previous;
 };
 
-struct seed
+struct EnemyHandle
 {
-    v2f position;
-    bool remove;
+    uint32_t slot;
+    uint32_t generation;
 };
 
-enum class GameState
+struct EnemySlot
 {
-    MainMenu,
-    GameLoop,
-    EndSuccess,
-    EndFail,
-    Stats
-};
-
-uint32_t enemy_colors[8] = {
-    0xFF820C58, 0xFF7347FE, 0xFF8DD6F6, 0xFFA1308F,
-    0xFF0C1B59, 0xFF0000FF, 0xFFABCFC1, 0xFFD5C6AC
+    uint32_t generation;
+    pShape type;
+    int index;
 };
 
-struct Stats
+template <class T> struct EnemyPool
 {
-    int SeedsCollected;
-    int EnemiesKilled;
-    int EnemiesSpawned;
-    int MissilesFired;
-    int MissilesHit;
-    int PlayerDeaths; 
+    std::vector<T> shapes;
+    std::vector<Enemy> enemies;
+    std::vector<uint32_t> owners;
+    pArray<real> x, y;
+    pArray<real> dirX, dirY;
+    pArray<real> speed;
+    pArray<uint8_t> inRange;
+    inline int Size() {return shapes.size();}
+    inline void Push(const T& shape, const Enemy& enemy, uint32_t owner)
+    {
+        shapes.push_back(shape);
+        enemies.push_back(enemy);
+        owners.push_back(owner);
+        enemies.back().previous = shape.position;
+        x.push_back(shape.position.x);
+        y.push_back(shape.position.y);
+        dirX.push_back(1.0f);
+        dirY.push_back(0.0f);
+        speed.push_back(enemy.velocity);
+        inRange.push_back(0);
+    }
+    inline void Move(int dst, int src)
+    {
+        shapes[dst] = shapes[src];
+        enemies[dst] = enemies[src];
+        owners[dst] = owners[src];
+        x[dst] = x[src]; y[dst] = y[src];
+        dirX[dst] = dirX[src]; dirY[dst] = dirY[src];
+        speed[dst] = speed[src];
+        inRange[dst] = inRange[src];
+    }
+    inline void Pop()
+    {
+        shapes.pop_back();
+        enemies.pop_back();
+        owners.pop_back();
+        x.pop_back(); y.pop_back();
+        dirX.pop_back(); dirY.pop_back();
+        speed.pop_back();
+        inRange.pop_back();
+    }
 };
 
-class Game
+struct EnemyStore
 {
-private:
-    Stats stats;
-    Window window;
-    Player player;
-    pSystem ps;
-    pData explosion;
-    pData kill;
-    pData smoke;
-    std::vector<Enemy> enemies;
-    std::vector<Missile> missiles;
-    std::vector<seed> seeds;
-    GameState currentState;
-    Captures captures;
-    Button start, retry, home, stat, back;
-    DataNode savefile;
-public:
-    inline void Start()
+    EnemyPool<Circle> circles;
+    EnemyPool<Rect> rects;
+    EnemyPool<Triangle> triangles;
+    std::vector<EnemySlot> slots;
+    std::vector<uint32_t> freeSlots;
+    template <class T> inline EnemyHandle Insert(EnemyPool<T>& pool, pShape type, const T& shape, const Enemy& enemy)
     {
-        currentState = GameState::MainMenu;
-        
-        srand(time(0));
+        uint32_t slot;
+        if(freeSlots.empty())
+        {
+            slot = slots.size();
+            slots.push_back({0, type, 0});
+        }
+        else
+        {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        slots[slot].type = type;
+        slots[slot].index = pool.Size();
+        pool.Push(shape, enemy, slot);
+        return {slot, slots[slot].generation};
+    }
+    inline EnemyHandle Add(const Circle& shape, const Enemy& enemy) {return Insert(circles, pShape::Circle, shape, enemy);}
+    inline EnemyHandle Add(const Rect& shape, const Enemy& enemy) {return Insert(rects, pShape::Rect, shape, enemy);}
+    inline EnemyHandle Add(const Triangle& shape, const Enemy& enemy) {return Insert(triangles, pShape::Triangle, shape, enemy);}
+    inline bool Alive(EnemyHandle handle)
+    {
+        return handle.slot < slots.size() && slots[handle.slot].generation == handle.generation;
+    }
+    inline Enemy* Get(EnemyHandle handle)
+    {
+        if(!Alive(handle)) return nullptr;
+        const EnemySlot& slot = slots[handle.slot];
+        switch(slot.type)
+        {
+            case pShape::Circle: return &circles.enemies[slot.index];
+            case pShape::Rect: return &rects.enemies[slot.index];
+            case pShape::Triangle: return &triangles.enemies[slot.index];
+            default: return nullptr;
+        }
+    }
+    template <class T> inline void RemoveAt(EnemyPool<T>& pool, int index)
+    {
+        const uint32_t slot = pool.owners[index];
+        const int last = pool.Size() - 1;
+        if(index != last)
+        {
+            pool.Move(index, last);
+            slots[pool.owners[index]].index = index;
+        }
+        pool.Pop();
+        slots[slot].generation++;
+        freeSlots.push_back(slot);
+    }
+    inline void Remove(EnemyHandle handle)
+    {
+        if(!Alive(handle)) return;
+        const EnemySlot& slot = slots[handle.slot];
+        switch(slot.type)
+        {
+            case pShape::Circle: RemoveAt(circles, slot.index); break;
+            case pShape::Rect: RemoveAt(rects, slot.index); break;
+            case pShape::Triangle: RemoveAt(triangles, slot.index); break;
+            default: break;
+        }
+    }
+    template <class T> inline void Collect(EnemyPool<T>& pool)
+    {
+        for(int i = 0; i < pool.Size();)
+        {
+            if(pool.enemies[i].remove)
+                RemoveAt(pool, i);
+            else
+                i++;
+        }
+    }
+    inline void Collect()
+    {
+        Collect(circles);
+        Collect(rects);
+        Collect(triangles);
+    }
+    template <class T, class F> inline void ForEach(EnemyPool<T>& pool, const F& f)
+    {
+        for(int i = 0; i < pool.Size(); i++)
+            f(pool.shapes[i], pool.enemies[i], EnemyHandle{pool.owners[i], slots[pool.owners[i]].generation});
+    }
+    template <class F> inline void ForEach(const F& f)
+    {
+        ForEach(circles, f);
+        ForEach(rects, f);
+        ForEach(triangles, f);
+    }
+    template <class T> inline void Steer(EnemyPool<T>& pool, const v2r* targets, int targetCount, real range)
+    {
+        const int count = pool.Size();
+        int i = 0;
+#if defined FIXED_POINT
+        for(; i < count; i++)
+        {
+            real dx = targets[0].x - pool.x[i];
+            real dy = targets[0].y - pool.y[i];
+            real length = hypot(dx, dy);
+            for(int t = 1; t < targetCount; t++)
+            {
+                const real tx = targets[t].x - pool.x[i];
+                const real ty = targets[t].y - pool.y[i];
+                const real distance = hypot(tx, ty);
+                if(distance < length)
+                {
+                    dx = tx;
+                    dy = ty;
+                    length = distance;
+                }
+            }
+            if(length > 0)
+            {
+                const int64_t inverse = (1ll << 48) / length.raw;
+                pool.dirX[i] = fixed::Raw((dx.raw * inverse) >> 32);
+                pool.dirY[i] = fixed::Raw((dy.raw * inverse) >> 32);
+            }
+            const bool inRange = length <= range;
+            const real step = inRange ? real(0) : pool.speed[i];
+            pool.x[i] += pool.dirX[i] * step;
+            pool.y[i] += pool.dirY[i] * step;
+            pool.inRange[i] = inRange;
+        }
+#else
+        const float r2 = range * range;
+#if defined __AVX2__
+        const __m256 vr2 = _mm256_set1_ps(r2), zero = _mm256_setzero_ps();
+        for(; i + 8 <= count; i += 8)
+        {
+            __m256 x = _mm256_load_ps(&pool.x[i]);
+            __m256 y = _mm256_load_ps(&pool.y[i]);
+            __m256 dx = _mm256_sub_ps(_mm256_set1_ps(targets[0].x), x);
+            __m256 dy = _mm256_sub_ps(_mm256_set1_ps(targets[0].y), y);
+            __m256 d2 = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+            for(int t = 1; t < targetCount; t++)
+            {
+                const __m256 tx = _mm256_sub_ps(_mm256_set1_ps(targets[t].x), x);
+                const __m256 ty = _mm256_sub_ps(_mm256_set1_ps(targets[t].y), y);
+                const __m256 t2 = _mm256_add_ps(_mm256_mul_ps(tx, tx), _mm256_mul_ps(ty, ty));
+                const __m256 closer = _mm256_cmp_ps(t2, d2, _CMP_LT_OQ);
+                dx = _mm256_blendv_ps(dx, tx, closer);
+                dy = _mm256_blendv_ps(dy, ty, closer);
+                d2 = _mm256_blendv_ps(d2, t2, closer);
+            }
+            const __m256 length = _mm256_sqrt_ps(d2);
+            const __m256 valid = _mm256_cmp_ps(d2, zero, _CMP_GT_OQ);
+            const __m256 dirX = _mm256_blendv_ps(_mm256_load_ps(&pool.dirX[i]), _mm256_div_ps(dx, length), valid);
+            const __m256 dirY = _mm256_blendv_ps(_mm256_load_ps(&pool.dirY[i]), _mm256_div_ps(dy, length), valid);
+            const __m256 inRange = _mm256_cmp_ps(d2, vr2, _CMP_LE_OQ);
+            const __m256 step = _mm256_andnot_ps(inRange, _mm256_load_ps(&pool.speed[i]));
+            x = _mm256_add_ps(x, _mm256_mul_ps(dirX, step));
+            y = _mm256_add_ps(y, _mm256_mul_ps(dirY, step));
+            _mm256_store_ps(&pool.x[i], x);
+            _mm256_store_ps(&pool.y[i], y);
+            _mm256_store_ps(&pool.dirX[i], dirX);
+            _mm256_store_ps(&pool.dirY[i], dirY);
+            const int mask = _mm256_movemask_ps(inRange);
+            for(int k = 0; k < 8; k++)
+                pool.inRange[i + k] = mask >> k & 1;
+        }
+#endif
+        for(; i < count; i++)
+        {
+            float dx = targets[0].x - pool.x[i];
+            float dy = targets[0].y - pool.y[i];
+            float d2 = dx * dx + dy * dy;
+            for(int t = 1; t < targetCount; t++)
+            {
+                const float tx = targets[t].x - pool.x[i];
+                const float ty = targets[t].y - pool.y[i];
+                const float t2 = tx * tx + ty * ty;
+                if(t2 < d2)
+                {
+                    dx = tx;
+                    dy = ty;
+                    d2 = t2;
+                }
+            }
+            const float length = std::sqrt(d2);
+            if(d2 > 0.0f)
+            {
+                pool.dirX[i] = dx / length;
+                pool.dirY[i] = dy / length;
+            }
+            const bool inRange = d2 <= r2;
+            const float step = inRange ? 0.0f : pool.speed[i];
+            pool.x[i] += pool.dirX[i] * step;
+            pool.y[i] += pool.dirY[i] * step;
+            pool.inRange[i] = inRange;
+        }
+#endif
+        for(i = 0; i < count; i++)
+        {
+            pool.enemies[i].previous = pool.shapes[i].position;
+            pool.shapes[i].position = v2f(v2r(pool.x[i], pool.y[i]));
+            pool.shapes[i].Orient(v2f(v2r(pool.dirY[i], -pool.dirX[i])));
+            pool.enemies[i].inRange = pool.inRange[i];
+        }
+    }
+    inline void Steer(const v2r* targets, int targetCount, real range)
+    {
+        if(targetCount <= 0) return;
+        Steer(circles, targets, targetCount, range);
+        Steer(rects, targets, targetCount, range);
+        Steer(triangles, targets, targetCount, range);
+    }
+    inline int Size()
+    {
+        return circles.Size() + rects.Size() + triangles.Size();
+    }
+    inline void Clear()
+    {
+        ForEach([&](Shape&, Enemy& enemy, EnemyHandle) {enemy.remove = true;});
+        Collect();
+    }
+};
+
+struct Player
+{
+    real velocity;
+    real size;
+    Rect rect;
+    int health;
+    int cooldown;
+    v2f previous;
+    v2r position;
+};
+
+struct Missile
+{
+    real velocity;
+    Triangle triangle;
+    real angle;
+    real distance_current;
+    real distance_max;
+    bool remove;
+    Trail trail;
+    v2f previous;
+    uint32_t id;
+    v2r position;
+};
+
+struct seed
+{
+    v2f position;
+    bool remove;
+    uint16_t id;
+};
+
+enum class GameState
+{
+    MainMenu,
+    GameLoop,
+    EndSuccess,
+    EndFail,
+    Stats
+};
+
+uint32_t enemy_colors[8] = {
+    0xFF820C58, 0xFF7347FE, 0xFF8DD6F6, 0xFFA1308F,
+    0xFF0C1B59, 0xFF0000FF, 0xFFABCFC1, 0xFFD5C6AC
+};
+
+struct Stats
+{
+    int SeedsCollected;
+    int EnemiesKilled;
+    int EnemiesSpawned;
+    int MissilesFired;
+    int MissilesHit;
+    int PlayerDeaths; 
+    inline void Add(const Stats& other)
+    {
+        SeedsCollected += other.SeedsCollected;
+        EnemiesKilled += other.EnemiesKilled;
+        EnemiesSpawned += other.EnemiesSpawned;
+        MissilesFired += other.MissilesFired;
+        MissilesHit += other.MissilesHit;
+        PlayerDeaths += other.PlayerDeaths;
+    }
+};
+
+struct Snapshot
+{
+    std::vector<uint8_t> data;
+    size_t cursor = 0;
+    bool reading = false;
+    uint32_t frame = 0;
+    inline void Write()
+    {
+        data.clear();
+        reading = false;
+    }
+    inline void Read()
+    {
+        cursor = 0;
+        reading = true;
+    }
+    inline void Bytes(void* bytes, size_t size)
+    {
+        if(size == 0) return;
+        if(reading)
+        {
+            memcpy(bytes, data.data() + cursor, size);
+            cursor += size;
+        }
+        else
+            data.insert(data.end(), (uint8_t*)bytes, (uint8_t*)bytes + size);
+    }
+    template <class T> inline void Field(T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        Bytes(&value, sizeof(T));
+    }
+    template <class T, class A> inline void Field(std::vector<T, A>& values)
+    {
+        uint32_t size = values.size();
+        Field(size);
+        if(reading) values.resize(size);
+        if constexpr(std::is_trivially_copyable_v<T>)
+            Bytes(values.data(), size * sizeof(T));
+        else
+            for(auto& value : values)
+                Field(value);
+    }
+    inline void Field(Shape& shape)
+    {
+        Field(shape.position);
+        Field(shape.color);
+        Field(shape.currentAngle);
+    }
+    inline void Field(Circle& circle)
+    {
+        Field((Shape&)circle);
+        Field(circle.radius);
+    }
+    inline void Field(Rect& rect)
+    {
+        Field((Shape&)rect);
+        Field(rect.width);
+        Field(rect.height);
+        Field(rect.vertices);
+        Field(rect.rotated);
+    }
+    inline void Field(Triangle& triangle)
+    {
+        Field((Shape&)triangle);
+        Field(triangle.vertices);
+        Field(triangle.currVertices);
+    }
+    inline void Field(Player& player)
+    {
+        Field(player.velocity);
+        Field(player.size);
+        Field(player.rect);
+        Field(player.health);
+        Field(player.cooldown);
+        Field(player.previous);
+        Field(player.position);
+    }
+    inline void Field(Missile& missile)
+    {
+        Field(missile.id);
+        Field(missile.velocity);
+        Field(missile.triangle);
+        Field(missile.angle);
+        Field(missile.distance_current);
+        Field(missile.distance_max);
+        Field(missile.remove);
+        Field(missile.trail);
+        Field(missile.previous);
+        Field(missile.position);
+    }
+};
+
+struct Rewind
+{
+    std::vector<Snapshot> ring;
+    int head = 0, count = 0;
+    size_t budget = 0;
+    inline int Capacity() {return ring.size();}
+    inline void Resize(int capacity)
+    {
+        ring.resize(capacity);
+        Clear();
+    }
+    inline void Clear()
+    {
+        head = count = 0;
+    }
+    inline Snapshot& Push()
+    {
+        int limit = Capacity();
+        const size_t last = count > 0 ? ring[(head - 1 + ring.size()) % ring.size()].data.size() : 0;
+        if(budget > 0 && last > 0)
+            limit = std::clamp((int)std::min(budget / last, (size_t)INT_MAX), 1, Capacity());
+        while(count >= limit)
+        {
+            Snapshot& oldest = ring[(head - count + ring.size()) % ring.size()];
+            if(&oldest != &ring[head])
+            {
+                if(count == limit)
+                    std::swap(oldest.data, ring[head].data);
+                std::vector<uint8_t>().swap(oldest.data);
+            }
+            count--;
+        }
+        Snapshot& snapshot = ring[head];
+        head = (head + 1) % ring.size();
+        count = std::min(count + 1, Capacity());
+        return snapshot;
+    }
+    inline Snapshot& Pop()
+    {
+        head = (head - 1 + ring.size()) % ring.size();
+        count--;
+        return ring[head];
+    }
+};
+
+enum class Outcome
+{
+    Playing, Success, Fail
+};
+
+struct ExplosionEvent
+{
+    v2f position;
+};
+
+struct KillEvent
+{
+    v2f position;
+    pShape shape;
+    uint32_t color;
+};
+
+struct PickupEvent
+{
+    v2f position;
+};
+
+struct DamageEvent
+{
+    v2f position;
+    float amount;
+    bool player;
+};
+
+struct Events
+{
+    std::vector<ExplosionEvent> explosions;
+    std::vector<KillEvent> kills;
+    std::vector<PickupEvent> pickups;
+    std::vector<DamageEvent> damage;
+    inline void Clear()
+    {
+        explosions.clear();
+        kills.clear();
+        pickups.clear();
+        damage.clear();
+    }
+};
+
+#define MAX_PLAYERS 4
+
+constexpr uint32_t player_colors[MAX_PLAYERS] = {0xFF00FF00, 0xFF00A5FF, 0xFFFF8000, 0xFF8000FF};
+
+class Simulation
+{
+public:
+    Stats stats = {};
+    std::array<Player, MAX_PLAYERS> players;
+    int playerCount = 1;
+    uint32_t nextMissile = 0;
+    EnemyStore enemies;
+    std::vector<EnemyHandle> enemyHandles;
+    std::vector<Missile> missiles;
+    std::vector<seed> seeds;
+    Random random;
+    SpatialGrid enemyGrid, seedGrid;
+    v2i world;
+    int seedCount;
+    int enemyCount = 4;
+    Outcome outcome = Outcome::Playing;
+    Events events;
+    float steerTime = 0.0f;
+    double steerTotal = 0.0;
+    int steerFrames = 0;
+    template <class T> inline void Transfer(Snapshot& snapshot, EnemyPool<T>& pool)
+    {
+        snapshot.Field(pool.shapes);
+        snapshot.Field(pool.enemies);
+        snapshot.Field(pool.owners);
+        snapshot.Field(pool.x);
+        snapshot.Field(pool.y);
+        snapshot.Field(pool.dirX);
+        snapshot.Field(pool.dirY);
+        snapshot.Field(pool.speed);
+        snapshot.Field(pool.inRange);
+    }
+    inline void Transfer(Snapshot& snapshot)
+    {
+        snapshot.Field(stats);
+        snapshot.Field(playerCount);
+        for(int i = 0; i < playerCount; i++)
+            snapshot.Field(players[i]);
+        snapshot.Field(nextMissile);
+        snapshot.Field(random);
+        snapshot.Field(outcome);
+        Transfer(snapshot, enemies.circles);
+        Transfer(snapshot, enemies.rects);
+        Transfer(snapshot, enemies.triangles);
+        snapshot.Field(enemies.slots);
+        snapshot.Field(enemies.freeSlots);
+        snapshot.Field(missiles);
+        snapshot.Field(seeds);
+    }
+    inline void Save(Snapshot& snapshot)
+    {
+        snapshot.Write();
+        Transfer(snapshot);
+    }
+    inline void Restore(Snapshot& snapshot)
+    {
+        snapshot.Read();
+        Transfer(snapshot);
+        events.Clear();
+    }
+    inline void Create(v2i size, v2i view)
+    {
+        world = size;
+        seedCount = 50 * (world.x * world.y) / (view.x * view.y);
+        enemyGrid.Create(world.x, world.y, 128.0f);
+        seedGrid.Create(world.x, world.y, 64.0f);
+        for(int i = 0; i < MAX_PLAYERS; i++)
+            players[i] = {5.0f, 30.0f, Rect(60, 60, 30, 30, player_colors[i]), 20};
+    }
+    inline bool Alive(int index)
+    {
+        return players[index].health > 0;
+    }
+    inline void Restart(uint64_t seed)
+    {
+        random.Seed(seed);
+        outcome = Outcome::Playing;
+        enemies.Clear();
+        seeds.clear();
+        missiles.clear();
+        events.Clear();
+        for(int i = 0; i < seedCount; i++)
+        {
+            seeds.push_back({
+                v2f(v2r{
+                    random.Range(real(10.0f), real(world.x - 10.0f)),
+                    random.Range(real(10.0f), real(world.y - 10.0f))
+                }), false, (uint16_t)i
+            });
+        }
+        nextMissile = 0;
+        for(int i = 0; i < playerCount; i++)
+            Spawn(i);
+    }
+    inline void Spawn(int index)
+    {
+        Player& player = players[index];
+        player.cooldown = 0;
+        player.health = 20.0f;
+        player.size = 30.0f;
+        player.rect.width = 30;
+        player.rect.height = 30;
+        player.velocity = 5.0f;
+        player.position = v2r(60.0f + 60.0f * index, 60.0f);
+        player.rect.position = v2f(player.position);
+        player.previous = player.rect.position;
+    }
+    inline void SpawnMissile(const v2r start, const v2r destination, uint32_t color, real distance_max)
+    {
+        Triangle tri;
+        equilateral(tri, 20);
+        tri.color = color;
+        v2r dist = destination - start;
+        tri.position = v2f(start);
+        missiles.push_back(Missile{
+            10.0f, tri, atan2(dist.y, dist.x),
+            0.0f, distance_max, false
+        });
+        missiles.back().previous = tri.position;
+        missiles.back().id = nextMissile++;
+        missiles.back().position = start;
+    }
+    inline void ExplodeMissile(Missile& m)
+    {
+        if(m.remove) return;
+        events.explosions.push_back({m.triangle.position});
+        m.remove = true;
+    }
+    inline void SpawnEnemy(pShape shape, v2r position)
+    {
+        const v2f start_pos = v2f(position);
+        stats.EnemiesSpawned++;
+        uint32_t color = enemy_colors[random.Range(0, 8)];
+        const Enemy enemy = {
+            6.0f, 20.0f, 
+            false, 100, shape
+        };
+        switch(shape)
+        {
+            case pShape::Circle:
+            {
+                enemies.Add(Circle(start_pos.x, start_pos.y, 10.0f, color), enemy);
+            }
+            break;
+            case pShape::Rect:
+            {
+                enemies.Add(Rect(start_pos.x, start_pos.y, 20.0f, 20.0f, color), enemy);
+            }
+            break;
+            case pShape::Triangle:
+            {
+                const float m = 0.577350269f;
+                enemies.Add(Triangle(v2f(0.0f, m * 20.0f), v2f(10.0f, -m * 20.0f), v2f(-10.0f, -m * 20.0f), start_pos, color), enemy);
+            }
+            break;
+            default: break;
+        };
+    }
+    inline void Step(const Input& input)
+    {
+        Step(&input);
+    }
+    inline v2r Nearest(const v2r* targets, int count, v2r position)
+    {
+        v2r nearest = targets[0];
+        real best = hypot(nearest.x - position.x, nearest.y - position.y);
+        for(int i = 1; i < count; i++)
+        {
+            const real distance = hypot(targets[i].x - position.x, targets[i].y - position.y);
+            if(distance < best)
+            {
+                best = distance;
+                nearest = targets[i];
+            }
+        }
+        return nearest;
+    }
+    inline void Step(const Input* inputs)
+    {
+        events.Clear();
+        while(enemies.Size() < enemyCount)
+        {
+            SpawnEnemy((pShape)random.Range(0, 3), 
+            {
+                random.Range(real(0.0f), real(world.x)),
+                random.Range(real(0.0f), real(world.y))
+            });
+        }
+
+        bool alive[MAX_PLAYERS];
+        v2r targets[MAX_PLAYERS];
+        int targetCount = 0;
+        for(int p = 0; p < playerCount; p++)
+        {
+            Player& player = players[p];
+            const Input& input = inputs[p];
+            player.previous = player.rect.position;
+            alive[p] = Alive(p);
+            if(!alive[p]) continue;
+
+            player.cooldown--;
+
+            if(input.keys[SDL_SCANCODE_W] && player.position.y - player.rect.height * 0.5 - player.velocity > 0) 
+                player.position.y -= player.velocity;
+            if(input.keys[SDL_SCANCODE_S] && player.position.y + player.rect.height * 0.5 + player.velocity < world.y)
+                player.position.y += player.velocity;
+            if(input.keys[SDL_SCANCODE_A] && player.position.x - player.rect.width * 0.5 - player.velocity > 0)
+                player.position.x -= player.velocity;
+            if(input.keys[SDL_SCANCODE_D] && player.position.x + player.rect.width * 0.5 + player.velocity < world.x) 
+                player.position.x += player.velocity;
+            player.rect.position = v2f(player.position);
+
+            if(player.cooldown <= 0 && (input.mouse.buttons & SDL_BUTTON(1)))
+            {
+                SpawnMissile(player.position, v2r(input.aim), 0xFF0000FF, 600.0f);
+                player.cooldown = 20;
+            }
+            targets[targetCount++] = player.position;
+        }
+
+        enemyGrid.Clear();
+        enemyHandles.clear();
+        enemies.ForEach([&](Shape& shape, Enemy& enemy, EnemyHandle handle)
+        {
+            enemyGrid.Insert(shape.position);
+            enemyHandles.push_back(handle);
+        });
+        enemyGrid.Build();
+
+        for(auto& m : missiles)
+        {
+            stats.MissilesFired++;
+            m.previous = m.triangle.position;
+            m.trail.Push(m.triangle.position);
+            m.position.x += cos(m.angle) * m.velocity;
+            m.position.y += sin(m.angle) * m.velocity;
+            m.triangle.position = v2f(m.position);
+            m.triangle.SetRotation((float)(m.angle - pi * 0.5f));
+            m.distance_current += m.velocity;
+            real expRadius = 1.0f;
+
+            if(m.distance_current > m.distance_max)
+            {
+                expRadius = 2.5f;
+                ExplodeMissile(m);
+            }
+
+            if(m.triangle.color == 0xFFFF0000)
+                for(int p = 0; p < playerCount; p++)
+                {
+                    Player& player = players[p];
+                    if(alive[p] && hypot(m.position.x - player.position.x,
+                        m.position.y - player.position.y) < player.rect.width * 0.6 * expRadius)
+                    {
+                        player.health -= 2;
+                        events.damage.push_back({player.rect.position, 2.0f, true});
+                        ExplodeMissile(m);
+                    }
+                }
+
+            const real radius = 30 * expRadius;
+            if(m.triangle.color == 0xFF0000FF)
+                enemyGrid.QueryRadius(m.triangle.position, (float)radius + 1.0f, [&](int i, float d2)
+                {
+                    const v2r d = v2r(enemyGrid.positions[i]) - m.position;
+                    if(hypot(d.x, d.y) >= radius) return;
+                    enemies.Get(enemyHandles[i])->health -= 10;
+                    events.damage.push_back({enemyGrid.positions[i], 10.0f, false});
+                    ExplodeMissile(m);
+                });
+        }
+
+        const uint64_t steerStart = SDL_GetPerformanceCounter();
+        enemies.Steer(targets, targetCount, 400.0f);
+        steerTime = (SDL_GetPerformanceCounter() - steerStart) * 1000.0f / SDL_GetPerformanceFrequency();
+        steerTotal += steerTime;
+        steerFrames++;
+
+        enemies.ForEach([&](auto& shape, Enemy& enemy, EnemyHandle handle)
+        {
+            if(enemy.inRange && enemy.cooldown <= 0)
+            {
+                SpawnMissile(v2r(shape.position), Nearest(targets, targetCount, v2r(shape.position)), 0xFFFF0000, 350.0f);
+                enemy.cooldown = 150;
+            }
+            
+            enemy.cooldown--;
+            
+            if(enemy.health <= 0)
+            {
+                events.kills.push_back({shape.position, enemy.data, shape.color});
+                enemy.remove = true;
+            }
+        });
+
+        seedGrid.Clear();
+        for(auto& s : seeds)
+            seedGrid.Insert(s.position);
+        seedGrid.Build();
+
+        for(int p = 0; p < playerCount; p++)
+        {
+            Player& player = players[p];
+            if(!alive[p]) continue;
+            seedGrid.QueryRect({
+                player.rect.position.x - player.rect.width * 0.5f, player.rect.position.y - player.rect.height * 0.5f,
+                player.rect.position.x + player.rect.width * 0.5f, player.rect.position.y + player.rect.height * 0.5f
+            }, [&](int i)
+            {
+                seed& s = seeds[i];
+                if(!s.remove)
+                {
+                    player.size += 2.5f * 50 / seedCount;
+                    player.rect.width = player.rect.height = (int)player.size;
+                    player.velocity += 0.01f * 50 / seedCount;
+                    s.remove = true;
+                    events.pickups.push_back({s.position});
+                }
+            });
+        }
+
+        if(seeds.empty())
+            outcome = Outcome::Success;
+
+        int living = 0;
+        for(int p = 0; p < playerCount; p++)
+        {
+            if(alive[p] && !Alive(p))
+                stats.PlayerDeaths++;
+            living += Alive(p);
+        }
+        if(living == 0)
+            outcome = Outcome::Fail;
+
+        enemies.Collect();
+        missiles.erase(std::remove_if(missiles.begin(), missiles.end(), [](Missile& m){return m.remove;}), missiles.end());
+        seeds.erase(std::remove_if(seeds.begin(), seeds.end(), [](seed& s){return s.remove;}), seeds.end());
+
+        Tally();
+    }
+    inline void Tally()
+    {
+        stats.EnemiesKilled += events.kills.size();
+        stats.SeedsCollected += events.pickups.size();
+        for(auto& damage : events.damage)
+            stats.MissilesHit += !damage.player;
+    }
+    inline uint64_t Checksum()
+    {
+        uint64_t hash = 14695981039346656037ull;
+        auto mix = [&](const auto& value)
+        {
+            const uint8_t* bytes = (const uint8_t*)&value;
+            for(size_t i = 0; i < sizeof(value); i++)
+                hash = (hash ^ bytes[i]) * 1099511628211ull;
+        };
+        mix(outcome);
+        for(int i = 0; i < playerCount; i++)
+        {
+            mix(players[i].position);
+            mix(players[i].size);
+            mix(players[i].health);
+            mix(players[i].velocity);
+        }
+        enemies.ForEach([&](auto& shape, Enemy& enemy, EnemyHandle handle)
+        {
+            mix(shape.position);
+            mix(enemy.health);
+            mix(enemy.cooldown);
+        });
+        for(auto& m : missiles)
+        {
+            mix(m.position);
+            mix(m.distance_current);
+        }
+        for(auto& s : seeds)
+            mix(s.position);
+        return hash;
+    }
+};
+
+struct Bot
+{
+    float range = 600.0f;
+    float deadzone = 2.0f;
+    inline void Act(Simulation& sim, Input& input, int index = 0)
+    {
+        const v2f position = sim.players[index].rect.position;
+        v2f target = position;
+        float best = INFINITY;
+        for(auto& s : sim.seeds)
+        {
+            const v2f d = s.position - position;
+            const float d2 = d.x * d.x + d.y * d.y;
+            if(d2 < best)
+            {
+                best = d2;
+                target = s.position;
+            }
+        }
+        const v2f d = target - position;
+        input.keys.fill(0);
+        input.keys[SDL_SCANCODE_W] = d.y < -deadzone;
+        input.keys[SDL_SCANCODE_S] = d.y > deadzone;
+        input.keys[SDL_SCANCODE_A] = d.x < -deadzone;
+        input.keys[SDL_SCANCODE_D] = d.x > deadzone;
+        best = range * range;
+        input.mouse = {0, 0, 0};
+        sim.enemies.ForEach([&](auto& shape, Enemy& enemy, EnemyHandle handle)
+        {
+            const v2f d = shape.position - position;
+            const float d2 = d.x * d.x + d.y * d.y;
+            if(d2 < best)
+            {
+                best = d2;
+                input.aim = shape.position;
+                input.mouse.buttons = SDL_BUTTON(1);
+            }
+        });
+    }
+};
+
+struct Batch
+{
+    int instances = 0;
+    int steps = 60 * 60 * 5;
+    int threads = std::max((int)std::thread::hardware_concurrency(), 1);
+    int enemies = 4;
+    uint64_t seed = 1;
+    inline bool Options(int argc, char** argv)
+    {
+        for(int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            if(i + 1 >= argc) break;
+            if(arg == "--batch")
+                instances = std::max(atoi(argv[++i]), 0);
+            else if(arg == "--steps")
+                steps = std::max(atoi(argv[++i]), 1);
+            else if(arg == "--threads")
+                threads = std::max(atoi(argv[++i]), 1);
+            else if(arg == "--seed")
+                seed = strtoull(argv[++i], nullptr, 10);
+            else if(arg == "--stress")
+                enemies = std::clamp(atoi(argv[++i]), 1, 100000);
+        }
+        return instances > 0;
+    }
+    inline int Run()
+    {
+        struct Result
+        {
+            Stats stats;
+            Outcome outcome;
+            int steps;
+            uint64_t checksum;
+        };
+        std::vector<uint64_t> seeds(instances);
+        std::vector<Result> results(instances);
+        Random random;
+        random.Seed(seed);
+        for(auto& s : seeds)
+            s = random.Next();
+
+        JobSystem jobs;
+        jobs.Start(threads - 1);
+        const uint64_t start = SDL_GetPerformanceCounter();
+        jobs.ParallelFor(instances, 1, [&](int begin, int end, int chunk)
+        {
+            for(int i = begin; i < end; i++)
+            {
+                Simulation sim;
+                Bot bot;
+                Input input = {};
+                sim.Create(v2i(3200, 2400), v2i(800, 600));
+                sim.enemyCount = enemies;
+                sim.Restart(seeds[i]);
+                int step = 0;
+                for(; step < steps && sim.outcome == Outcome::Playing; step++)
+                {
+                    bot.Act(sim, input);
+                    sim.Step(input);
+                }
+                results[i] = {sim.stats, sim.outcome, step, sim.Checksum()};
+            }
+        });
+        const double elapsed = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+        jobs.Stop();
+
+        Stats total = {};
+        uint64_t frames = 0, checksum = 0;
+        int won = 0, lost = 0;
+        for(auto& result : results)
+        {
+            total.Add(result.stats);
+            checksum = checksum * 1099511628211ull ^ result.checksum;
+            frames += result.steps;
+            won += result.outcome == Outcome::Success;
+            lost += result.outcome == Outcome::Fail;
+        }
+        const double rate = elapsed > 0.0 ? frames / elapsed : 0.0;
+        std::cout << "batch: " << instances << " runs, " << threads << " threads, seed " << seed << std::endl;
+        std::cout << "batch: " << won << " won, " << lost << " lost, " << instances - won - lost << " timed out after " << steps << " steps" << std::endl;
+        std::cout << "batch: " << frames << " frames in " << elapsed << " s, " << rate << " frames/s, " << rate / threads << " frames/s/core" << std::endl;
+        std::cout << "batch: per run killed " << (double)total.EnemiesKilled / instances << 
+        ", spawned " << (double)total.EnemiesSpawned / instances << 
+        ", fired " << (double)total.MissilesFired / instances <<
+        ", hit " << (double)total.MissilesHit / instances << 
+        ", seeds " << (double)total.SeedsCollected / instances << 
+        ", deaths " << (double)total.PlayerDeaths / instances << std::endl;
+        std::cout << "batch: checksum " << std::hex << checksum << std::dec << std::endl;
+        return 0;
+    }
+};
+
+#define NET_SCALE 2.0f
+#define NET_HISTORY 64
+#define NET_TIMEOUT 120
+
+enum class NetPacket : uint8_t
+{
+    Join = 1, Welcome, Input, State
+};
+
+struct NetEntity
+{
+    uint32_t id;
+    uint16_t x, y;
+    uint8_t kind, angle, health, generation;
+    inline bool operator==(const NetEntity& other) const
+    {
+        return id == other.id && x == other.x && y == other.y && kind == other.kind &&
+        angle == other.angle && health == other.health && generation == other.generation;
+    }
+};
+
+struct NetPlayer
+{
+    uint16_t x, y;
+    uint8_t health, size;
+    inline bool operator==(const NetPlayer& other) const
+    {
+        return x == other.x && y == other.y && health == other.health && size == other.size;
+    }
+};
+
+struct NetState
+{
+    uint32_t tick = 0;
+    uint64_t round = 0;
+    uint8_t outcome = 0;
+    uint8_t playerCount = 0;
+    uint16_t seedCount = 0;
+    std::array<NetPlayer, MAX_PLAYERS> players = {};
+    std::vector<NetEntity> enemies, missiles;
+    std::vector<uint16_t> seeds;
+    inline bool operator==(const NetState& other) const
+    {
+        return round == other.round && outcome == other.outcome && playerCount == other.playerCount &&
+        std::equal(players.begin(), players.begin() + playerCount, other.players.begin()) &&
+        enemies == other.enemies && missiles == other.missiles && seeds == other.seeds;
+    }
+};
+
+inline uint16_t NetQuantize(float value)
+{
+    return std::clamp((int)lround(value * NET_SCALE), 0, 65535);
+}
+
+inline float NetPosition(uint16_t value)
+{
+    return value / NET_SCALE;
+}
+
+inline uint8_t NetAngle(float angle)
+{
+    return (int)lround(angle * 256.0f / (2.0f * pi)) & 255;
+}
+
+inline float NetRadians(uint8_t angle)
+{
+    return angle * 2.0f * pi / 256.0f;
+}
+
+template <class T> inline void NetCapture(EnemyStore& store, EnemyPool<T>& pool, pShape shape, std::vector<NetEntity>& entities)
+{
+    for(int i = 0; i < pool.Size(); i++)
+    {
+        const uint32_t slot = pool.owners[i];
+        int color = 0;
+        while(color < 7 && enemy_colors[color] != pool.shapes[i].color) color++;
+        entities.push_back({
+            slot, NetQuantize(pool.shapes[i].position.x), NetQuantize(pool.shapes[i].position.y),
+            (uint8_t)((int)shape | color << 2), NetAngle((float)atan2(pool.dirY[i], pool.dirX[i])),
+            (uint8_t)std::clamp((int)pool.enemies[i].health, 0, 255), (uint8_t)store.slots[slot].generation
+        });
+    }
+}
+
+inline void NetCapture(Simulation& sim, NetState& state)
+{
+    state.outcome = (uint8_t)sim.outcome;
+    state.playerCount = sim.playerCount;
+    state.seedCount = sim.seedCount;
+    for(int i = 0; i < sim.playerCount; i++)
+    {
+        const Player& player = sim.players[i];
+        state.players[i] = {
+            NetQuantize(player.rect.position.x), NetQuantize(player.rect.position.y),
+            (uint8_t)std::clamp(player.health, 0, 255), (uint8_t)std::clamp(player.rect.width, 0, 255)
+        };
+    }
+    state.enemies.clear();
+    NetCapture(sim.enemies, sim.enemies.circles, pShape::Circle, state.enemies);
+    NetCapture(sim.enemies, sim.enemies.rects, pShape::Rect, state.enemies);
+    NetCapture(sim.enemies, sim.enemies.triangles, pShape::Triangle, state.enemies);
+    std::sort(state.enemies.begin(), state.enemies.end(), [](const NetEntity& a, const NetEntity& b){return a.id < b.id;});
+    state.missiles.clear();
+    for(auto& m : sim.missiles)
+    {
+        state.missiles.push_back({
+            m.id, NetQuantize(m.triangle.position.x), NetQuantize(m.triangle.position.y),
+            m.triangle.color == 0xFFFF0000, NetAngle((float)m.angle), 0, 0
+        });
+    }
+    state.seeds.clear();
+    for(auto& s : sim.seeds)
+        state.seeds.push_back(s.id);
+}
+
+inline void NetWriteByte(BitWriter& writer, uint8_t value, uint8_t base)
+{
+    writer.Write(value != base, 1);
+    if(value != base) writer.Write(value, 8);
+}
+
+inline uint8_t NetReadByte(BitReader& reader, uint8_t base)
+{
+    return reader.Read(1) ? reader.Read(8) : base;
+}
+
+inline void NetEncode(const std::vector<NetEntity>& entities, const std::vector<NetEntity>* base, BitWriter& writer)
+{
+    writer.WritePacked(entities.size());
+    uint32_t previous = 0;
+    size_t j = 0;
+    for(auto& e : entities)
+    {
+        writer.WritePacked(e.id - previous);
+        previous = e.id;
+        if(base)
+        {
+            while(j < base->size() && (*base)[j].id < e.id) j++;
+            const NetEntity* match = j < base->size() && (*base)[j].id == e.id &&
+            (*base)[j].generation == e.generation && (*base)[j].kind == e.kind ? &(*base)[j] : nullptr;
+            writer.Write(match != nullptr, 1);
+            if(match)
+            {
+                const bool moved = e.x != match->x || e.y != match->y;
+                writer.Write(moved, 1);
+                if(moved)
+                {
+                    writer.WriteSigned(e.x - match->x);
+                    writer.WriteSigned(e.y - match->y);
+                }
+                NetWriteByte(writer, e.angle, match->angle);
+                NetWriteByte(writer, e.health, match->health);
+                continue;
+            }
+        }
+        writer.Write(e.x, 16);
+        writer.Write(e.y, 16);
+        writer.Write(e.kind, 8);
+        writer.Write(e.angle, 8);
+        writer.Write(e.health, 8);
+        writer.Write(e.generation, 8);
+    }
+}
+
+inline void NetDecode(BitReader& reader, std::vector<NetEntity>& entities, const std::vector<NetEntity>* base)
+{
+    entities.resize(std::min<uint32_t>(reader.ReadPacked(), PACKET_CAPACITY));
+    uint32_t previous = 0;
+    size_t j = 0;
+    for(auto& e : entities)
+    {
+        e.id = previous + reader.ReadPacked();
+        previous = e.id;
+        if(base && reader.Read(1))
+        {
+            while(j < base->size() && (*base)[j].id < e.id) j++;
+            if(j >= base->size() || (*base)[j].id != e.id)
+            {
+                reader.overflow = true;
+                return;
+            }
+            e = (*base)[j];
+            if(reader.Read(1))
+            {
+                e.x += reader.ReadSigned();
+                e.y += reader.ReadSigned();
+            }
+            e.angle = NetReadByte(reader, e.angle);
+            e.health = NetReadByte(reader, e.health);
+            continue;
+        }
+        e.x = reader.Read(16);
+        e.y = reader.Read(16);
+        e.kind = reader.Read(8);
+        e.angle = reader.Read(8);
+        e.health = reader.Read(8);
+        e.generation = reader.Read(8);
+    }
+}
+
+inline void NetEncode(const NetState& state, const NetState* base, BitWriter& writer)
+{
+    writer.Write((uint32_t)NetPacket::State, 8);
+    writer.Write(state.tick, 32);
+    writer.WritePacked(base ? state.tick - base->tick : 0);
+    if(!base)
+    {
+        writer.Write(state.round, 32);
+        writer.Write(state.round >> 32, 32);
+        writer.Write(state.seedCount, 16);
+    }
+    writer.Write(state.outcome, 2);
+    writer.Write(state.playerCount, 3);
+    for(int i = 0; i < state.playerCount; i++)
+    {
+        const NetPlayer& p = state.players[i];
+        if(base)
+        {
+            const NetPlayer& b = base->players[i];
+            writer.Write(!(p == b), 1);
+            if(p == b) continue;
+            writer.WriteSigned(p.x - b.x);
+            writer.WriteSigned(p.y - b.y);
+            NetWriteByte(writer, p.health, b.health);
+            NetWriteByte(writer, p.size, b.size);
+            continue;
+        }
+        writer.Write(p.x, 16);
+        writer.Write(p.y, 16);
+        writer.Write(p.health, 8);
+        writer.Write(p.size, 8);
+    }
+    NetEncode(state.enemies, base ? &base->enemies : nullptr, writer);
+    NetEncode(state.missiles, base ? &base->missiles : nullptr, writer);
+    if(base)
+    {
+        std::vector<uint16_t> removed;
+        std::set_difference(base->seeds.begin(), base->seeds.end(), state.seeds.begin(), state.seeds.end(), std::back_inserter(removed));
+        writer.WritePacked(removed.size());
+        uint16_t previous = 0;
+        for(uint16_t id : removed)
+        {
+            writer.WritePacked(id - previous);
+            previous = id;
+        }
+    }
+    else
+    {
+        size_t j = 0;
+        for(int i = 0; i < state.seedCount; i++)
+        {
+            const bool alive = j < state.seeds.size() && state.seeds[j] == i;
+            writer.Write(alive, 1);
+            j += alive;
+        }
+    }
+}
+
+inline bool NetDecode(BitReader& reader, NetState& state, const std::array<NetState, NET_HISTORY>& history)
+{
+    state.tick = reader.Read(32);
+    const uint32_t offset = reader.ReadPacked();
+    const uint32_t baseTick = state.tick - offset;
+    const NetState* base = nullptr;
+    if(offset)
+    {
+        base = &history[baseTick % NET_HISTORY];
+        if(base->tick != baseTick) return false;
+        state.round = base->round;
+        state.seedCount = base->seedCount;
+    }
+    else
+    {
+        state.round = reader.Read(32);
+        state.round |= (uint64_t)reader.Read(32) << 32;
+        state.seedCount = reader.Read(16);
+    }
+    state.outcome = reader.Read(2);
+    state.playerCount = std::min<int>(reader.Read(3), MAX_PLAYERS);
+    for(int i = 0; i < state.playerCount; i++)
+    {
+        NetPlayer& p = state.players[i];
+        if(base)
+        {
+            p = base->players[i];
+            if(!reader.Read(1)) continue;
+            p.x += reader.ReadSigned();
+            p.y += reader.ReadSigned();
+            p.health = NetReadByte(reader, p.health);
+            p.size = NetReadByte(reader, p.size);
+            continue;
+        }
+        p.x = reader.Read(16);
+        p.y = reader.Read(16);
+        p.health = reader.Read(8);
+        p.size = reader.Read(8);
+    }
+    NetDecode(reader, state.enemies, base ? &base->enemies : nullptr);
+    NetDecode(reader, state.missiles, base ? &base->missiles : nullptr);
+    state.seeds.clear();
+    if(base)
+    {
+        const uint32_t count = reader.ReadPacked();
+        uint16_t removed = 0;
+        size_t j = 0;
+        for(uint32_t i = 0; i < count && !reader.overflow; i++)
+        {
+            removed += reader.ReadPacked();
+            for(; j < base->seeds.size() && base->seeds[j] < removed; j++)
+                state.seeds.push_back(base->seeds[j]);
+            j += j < base->seeds.size() && base->seeds[j] == removed;
+        }
+        state.seeds.insert(state.seeds.end(), base->seeds.begin() + j, base->seeds.end());
+    }
+    else
+    {
+        for(int i = 0; i < state.seedCount && !reader.overflow; i++)
+            if(reader.Read(1)) state.seeds.push_back(i);
+    }
+    return !reader.overflow;
+}
+
+inline void NetApply(const NetState& state, const NetState& previous, Simulation& sim)
+{
+    Events& events = sim.events;
+    events.Clear();
+    sim.outcome = (Outcome)state.outcome;
+    sim.playerCount = state.playerCount;
+    for(int i = 0; i < state.playerCount; i++)
+    {
+        Player& player = sim.players[i];
+        const NetPlayer& p = state.players[i];
+        player.previous = player.rect.position;
+        player.rect.position = v2f(NetPosition(p.x), NetPosition(p.y));
+        player.position = v2r(player.rect.position);
+        player.health = p.health;
+        player.size = p.size;
+        player.rect.width = player.rect.height = p.size;
+    }
+
+    std::unordered_map<uint32_t, const NetEntity*> last;
+    for(auto& e : previous.enemies)
+        last[e.id] = &e;
+    for(auto& e : state.enemies)
+    {
+        auto it = last.find(e.id);
+        if(it != last.end() && it->second->generation == e.generation)
+            last.erase(it);
+    }
+    for(auto& [id, e] : last)
+        events.kills.push_back({v2f(NetPosition(e->x), NetPosition(e->y)), (pShape)(e->kind & 3), enemy_colors[e->kind >> 2 & 7]});
+
+    sim.enemies.Clear();
+    size_t j = 0;
+    for(auto& e : state.enemies)
+    {
+        while(j < previous.enemies.size() && previous.enemies[j].id < e.id) j++;
+        const bool known = j < previous.enemies.size() && previous.enemies[j].id == e.id && previous.enemies[j].generation == e.generation;
+        const v2f position(NetPosition(e.x), NetPosition(e.y));
+        const v2f direction(sin(NetRadians(e.angle)), -cos(NetRadians(e.angle)));
+        const uint32_t color = enemy_colors[e.kind >> 2 & 7];
+        const Enemy enemy = {0.0f, (float)e.health, false, 0, (pShape)(e.kind & 3)};
+        EnemyHandle handle;
+        switch(enemy.data)
+        {
+            case pShape::Circle:
+            {
+                handle = sim.enemies.Add(Circle(position.x, position.y, 10.0f, color), enemy);
+            }
+            break;
+            case pShape::Rect:
+            {
+                Rect rect(position.x, position.y, 20.0f, 20.0f, color);
+                rect.Orient(direction);
+                handle = sim.enemies.Add(rect, enemy);
+            }
+            break;
+            default:
+            {
+                const float m = 0.577350269f;
+                Triangle triangle(v2f(0.0f, m * 20.0f), v2f(10.0f, -m * 20.0f), v2f(-10.0f, -m * 20.0f), position, color);
+                triangle.Orient(direction);
+                handle = sim.enemies.Add(triangle, enemy);
+            }
+            break;
+        }
+        if(known)
+            sim.enemies.Get(handle)->previous = v2f(NetPosition(previous.enemies[j].x), NetPosition(previous.enemies[j].y));
+    }
+
+    std::vector<Missile> missiles;
+    missiles.reserve(state.missiles.size());
+    j = 0;
+    for(auto& e : state.missiles)
+    {
+        for(; j < sim.missiles.size() && sim.missiles[j].id < e.id; j++)
+            events.explosions.push_back({sim.missiles[j].triangle.position});
+        const v2f position(NetPosition(e.x), NetPosition(e.y));
+        if(j < sim.missiles.size() && sim.missiles[j].id == e.id)
+        {
+            missiles.push_back(sim.missiles[j++]);
+            missiles.back().previous = missiles.back().triangle.position;
+            missiles.back().trail.Push(missiles.back().previous);
+        }
+        else
+        {
+            Triangle tri;
+            equilateral(tri, 20);
+            tri.currentAngle = 0.0f;
+            missiles.push_back(Missile{10.0f, tri, 0.0f, 0.0f, 0.0f, false});
+            missiles.back().previous = position;
+        }
+        Missile& m = missiles.back();
+        m.id = e.id;
+        m.angle = NetRadians(e.angle);
+        m.triangle.color = e.kind ? 0xFFFF0000 : 0xFF0000FF;
+        m.triangle.position = position;
+        m.position = v2r(position);
+        m.triangle.SetRotation((float)(m.angle - pi * 0.5f));
+    }
+    for(; j < sim.missiles.size(); j++)
+        events.explosions.push_back({sim.missiles[j].triangle.position});
+    sim.missiles.swap(missiles);
+
+    j = 0;
+    for(auto& s : sim.seeds)
+    {
+        while(j < state.seeds.size() && state.seeds[j] < s.id) j++;
+        s.remove = j >= state.seeds.size() || state.seeds[j] != s.id;
+        if(s.remove) events.pickups.push_back({s.position});
+    }
+    sim.seeds.erase(std::remove_if(sim.seeds.begin(), sim.seeds.end(), [](seed& s){return s.remove;}), sim.seeds.end());
+}
+
+struct NetPeer
+{
+    Address address;
+    int index;
+    uint32_t acked = 0, sequence = 0, heard = 0;
+    Input input = {};
+};
+
+struct NetServer
+{
+    Socket socket;
+    std::vector<NetPeer> peers;
+    std::array<NetState, NET_HISTORY> history;
+    BitWriter writer;
+    std::vector<uint8_t> buffer;
+    uint32_t tick = 0;
+    uint64_t round = 0;
+    int playerCount = 1, firstRemote = 1;
+    uint64_t bytes = 0, packets = 0;
+    int largest = 0;
+    double encodeTime = 0.0;
+    inline bool Host(uint16_t port, int players, int first)
+    {
+        playerCount = players;
+        firstRemote = first;
+        peers.clear();
+        buffer.resize(PACKET_CAPACITY);
+        return socket.Open(port);
+    }
+    inline void Restart(uint64_t seed)
+    {
+        round = seed;
+        for(auto& peer : peers)
+            peer.acked = 0;
+    }
+    inline void Poll(Input* inputs)
+    {
+        Address from;
+        int size;
+        while(socket.open && (size = socket.Receive(from, buffer.data(), buffer.size())) > 0)
+        {
+            BitReader reader(buffer.data(), size);
+            const NetPacket type = (NetPacket)reader.Read(8);
+            auto peer = std::find_if(peers.begin(), peers.end(), [&](NetPeer& p){return p.address == from;});
+            if(type == NetPacket::Join)
+            {
+                if(peer == peers.end() && firstRemote + (int)peers.size() < playerCount)
+                {
+                    peers.push_back({from, firstRemote + (int)peers.size()});
+                    peer = peers.end() - 1;
+                }
+                if(peer == peers.end()) continue;
+                peer->heard = tick;
+                writer.Reset();
+                writer.Write((uint32_t)NetPacket::Welcome, 8);
+                writer.Write(peer->index, 3);
+                writer.Write(playerCount, 3);
+                writer.Flush();
+                socket.Send(from, writer.bytes.data(), writer.Size());
+            }
+            else if(type == NetPacket::Input && peer != peers.end())
+            {
+                const uint32_t ack = reader.Read(32);
+                const uint32_t sequence = reader.Read(32);
+                InputFrame frame = {};
+                frame.keys = reader.Read(4);
+                frame.buttons = reader.Read(1) ? SDL_BUTTON(1) : 0;
+                frame.aimX = NetPosition(reader.Read(16));
+                frame.aimY = NetPosition(reader.Read(16));
+                if(reader.overflow || sequence <= peer->sequence) continue;
+                peer->sequence = sequence;
+                peer->heard = tick;
+                if(ack > peer->acked && ack <= tick)
+                    peer->acked = ack;
+                InputLog::Apply(frame, peer->input);
+            }
+        }
+        for(auto& peer : peers)
+            inputs[peer.index] = tick - peer.heard > NET_TIMEOUT ? Input{} : peer.input;
+    }
+    inline void Broadcast(Simulation& sim)
+    {
+        const uint64_t start = SDL_GetPerformanceCounter();
+        tick++;
+        NetState& state = history[tick % NET_HISTORY];
+        NetCapture(sim, state);
+        state.tick = tick;
+        state.round = round;
+        for(auto& peer : peers)
+        {
+            const NetState* base = nullptr;
+            if(peer.acked && tick - peer.acked < NET_HISTORY)
+            {
+                const NetState& candidate = history[peer.acked % NET_HISTORY];
+                if(candidate.tick == peer.acked && candidate.round == round)
+                    base = &candidate;
+            }
+            writer.Reset();
+            NetEncode(state, base, writer);
+            writer.Flush();
+            if(writer.Size() > PACKET_CAPACITY || !socket.Send(peer.address, writer.bytes.data(), writer.Size()))
+                continue;
+            bytes += writer.Size();
+            packets++;
+            largest = std::max(largest, writer.Size());
+        }
+        encodeTime += (SDL_GetPerformanceCounter() - start) * 1000000.0 / SDL_GetPerformanceFrequency();
+    }
+};
+
+struct NetClient
+{
+    Socket socket;
+    Address server;
+    int index = -1, playerCount = 0;
+    uint32_t sequence = 0, latest = 0;
+    std::array<NetState, NET_HISTORY> history;
+    NetState decoded;
+    BitWriter writer;
+    std::vector<uint8_t> buffer;
+    uint64_t bytes = 0, packets = 0, dropped = 0;
+    double decodeTime = 0.0;
+    inline bool Join(const Address& address)
+    {
+        server = address;
+        buffer.resize(PACKET_CAPACITY);
+        return socket.Open(0);
+    }
+    inline void Send(const Input& input)
+    {
+        writer.Reset();
+        if(index < 0)
+            writer.Write((uint32_t)NetPacket::Join, 8);
+        else
+        {
+            const InputFrame frame = InputLog::Capture(input, 0);
+            writer.Write((uint32_t)NetPacket::Input, 8);
+            writer.Write(latest, 32);
+            writer.Write(++sequence, 32);
+            writer.Write(frame.keys, 4);
+            writer.Write((frame.buttons & SDL_BUTTON(1)) != 0, 1);
+            writer.Write(NetQuantize(frame.aimX), 16);
+            writer.Write(NetQuantize(frame.aimY), 16);
+        }
+        writer.Flush();
+        socket.Send(server, writer.bytes.data(), writer.Size());
+    }
+    inline bool Poll()
+    {
+        bool received = false;
+        Address from;
+        int size;
+        while(socket.open && (size = socket.Receive(from, buffer.data(), buffer.size())) > 0)
+        {
+            if(from != server) continue;
+            BitReader reader(buffer.data(), size);
+            const NetPacket type = (NetPacket)reader.Read(8);
+            if(type == NetPacket::Welcome && index < 0)
+            {
+                const int slot = reader.Read(3);
+                const int count = reader.Read(3);
+                if(reader.overflow || count < 1 || count > MAX_PLAYERS || slot >= count) continue;
+                index = slot;
+                playerCount = count;
+            }
+            else if(type == NetPacket::State && index >= 0)
+            {
+                const uint64_t start = SDL_GetPerformanceCounter();
+                bytes += size;
+                packets++;
+                if(!NetDecode(reader, decoded, history) || decoded.tick <= latest)
+                {
+                    dropped++;
+                    continue;
+                }
+                history[decoded.tick % NET_HISTORY] = decoded;
+                latest = decoded.tick;
+                received = true;
+                decodeTime += (SDL_GetPerformanceCounter() - start) * 1000000.0 / SDL_GetPerformanceFrequency();
+            }
+        }
+        return received;
+    }
+    inline const NetState& State()
+    {
+        return history[latest % NET_HISTORY];
+    }
+};
+
+struct NetBench
+{
+    int clients = 0;
+    int steps = 60 * 60;
+    int enemies = 4;
+    uint64_t seed = 1;
+    inline bool Options(int argc, char** argv)
+    {
+        for(int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            if(i + 1 >= argc) break;
+            if(arg == "--netbench")
+                clients = std::clamp(atoi(argv[++i]), 0, MAX_PLAYERS);
+            else if(arg == "--steps")
+                steps = std::max(atoi(argv[++i]), 1);
+            else if(arg == "--seed")
+                seed = strtoull(argv[++i], nullptr, 10);
+            else if(arg == "--stress")
+                enemies = std::clamp(atoi(argv[++i]), 1, 100000);
+        }
+        return clients > 0;
+    }
+    inline int Run()
+    {
+        NetServer server;
+        Address address;
+        if(!server.Host(0, clients, 0) || !Resolve("127.0.0.1", address))
+        {
+            std::cout << "netbench: cannot open server socket" << std::endl;
+            return 1;
+        }
+        address.port = server.socket.Port();
+
+        std::vector<NetClient> peers(clients);
+        std::vector<Simulation> mirrors(clients);
+        std::vector<NetState> applied(clients);
+        std::array<Input, MAX_PLAYERS> inputs = {}, local = {};
+        for(auto& peer : peers)
+            peer.Join(address);
+        for(int attempt = 0; attempt < 100 && server.peers.size() < (size_t)clients; attempt++)
+        {
+            for(auto& peer : peers)
+                peer.Send(local[0]);
+            server.Poll(inputs.data());
+            for(auto& peer : peers)
+                peer.Poll();
+        }
+        for(auto& peer : peers)
+            peer.Poll();
+        if(std::any_of(peers.begin(), peers.end(), [](NetClient& peer){return peer.index < 0;}))
+        {
+            std::cout << "netbench: clients failed to join" << std::endl;
+            return 1;
+        }
+
+        Simulation sim;
+        sim.Create(v2i(3200, 2400), v2i(800, 600));
+        sim.enemyCount = enemies;
+        sim.playerCount = clients;
+        for(auto& mirror : mirrors)
+            mirror.Create(v2i(3200, 2400), v2i(800, 600));
+        Random random;
+        random.Seed(seed);
+        const uint64_t round = random.Next();
+        sim.Restart(round);
+        server.Restart(round);
+
+        Bot bot;
+        Snapshot snapshot;
+        BitWriter full;
+        uint64_t fullBytes = 0, snapshotBytes = 0, entities = 0, missing = 0, mismatches = 0;
+        int samples = 0, tick = 0;
+        for(; tick < steps && sim.outcome == Outcome::Playing; tick++)
+        {
+            for(int c = 0; c < clients; c++)
+            {
+                bot.Act(mirrors[c], local[c], peers[c].index);
+                peers[c].Send(local[c]);
+            }
+            server.Poll(inputs.data());
+            sim.Step(inputs.data());
+            server.Broadcast(sim);
+            const NetState& current = server.history[server.tick % NET_HISTORY];
+            entities += current.enemies.size() + current.missiles.size();
+            for(int c = 0; c < clients; c++)
+            {
+                if(!peers[c].Poll())
+                {
+                    missing++;
+                    continue;
+                }
+                const NetState& state = peers[c].State();
+                if(state.round != applied[c].round)
+                {
+                    mirrors[c].playerCount = state.playerCount;
+                    mirrors[c].Restart(state.round);
+                    applied[c] = NetState();
+                }
+                NetApply(state, applied[c], mirrors[c]);
+                applied[c] = state;
+                mismatches += !(state == server.history[state.tick % NET_HISTORY]);
+            }
+            if(tick % 30 == 0)
+            {
+                full.Reset();
+                NetEncode(current, nullptr, full);
+                full.Flush();
+                fullBytes += full.Size();
+                sim.Save(snapshot);
+                snapshotBytes += snapshot.data.size();
+                samples++;
+            }
+        }
 
-        window.Init("Window", 800, 600);
+        uint64_t received = 0, dropped = 0;
+        double decodeTime = 0.0;
+        for(auto& peer : peers)
+        {
+            received += peer.packets;
+            dropped += peer.dropped;
+            decodeTime += peer.decodeTime;
+        }
+        const double perClient = server.packets ? (double)server.bytes / server.packets : 0.0;
+        std::cout << "netbench: " << clients << " clients, " << tick << " ticks, seed " << seed <<
+        ", " << (tick ? (double)entities / tick : 0.0) << " entities/tick" << std::endl;
+        std::cout << "netbench: delta " << perClient << " bytes/tick/client (max " << server.largest <<
+        "), full " << (samples ? (double)fullBytes / samples : 0.0) << " bytes, snapshot " <<
+        (samples ? (double)snapshotBytes / samples : 0.0) << " bytes" << std::endl;
+        std::cout << "netbench: " << perClient * 60.0 * 8.0 / 1000.0 << " kbit/s/client at 60 Hz, encode " <<
+        (tick ? server.encodeTime / tick : 0.0) << " us/tick, decode " << (received ? decodeTime / received : 0.0) << " us/packet" << std::endl;
+        std::cout << "netbench: " << received << " packets, " << missing << " late, " << dropped << " dropped, " << mismatches << " mismatches" << std::endl;
+        return mismatches ? 1 : 0;
+    }
+};
+
+struct SaveBench
+{
+    int megabytes = 0;
+    int runs = 5;
+    std::string file = "savebench.txt";
+    inline bool Options(int argc, char** argv)
+    {
+        for(int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            if(i + 1 >= argc) break;
+            if(arg == "--savebench")
+                megabytes = std::clamp(atoi(argv[++i]), 0, 1024);
+            else if(arg == "--runs")
+                runs = std::max(atoi(argv[++i]), 1);
+        }
+        return megabytes > 0;
+    }
+    static bool Equal(const DataNode& a, const DataNode& b)
+    {
+        if(a.data.size() != b.data.size() || a.nodes.size() != b.nodes.size()) return false;
+        for(std::size_t i = 0; i < a.data.size(); i++)
+            if(a.data[i].content != b.data[i].content || a.data[i].name != b.data[i].name) return false;
+        for(auto& [name, node] : a.nodes)
+        {
+            auto other = b.nodes.find(name);
+            if(other == b.nodes.end() || !Equal(node, other->second)) return false;
+        }
+        return true;
+    }
+    static size_t Count(const DataNode& node)
+    {
+        size_t count = node.nodes.size();
+        for(auto& [name, child] : node.nodes)
+            count += Count(child);
+        return count;
+    }
+    inline int Run()
+    {
+        Random random;
+        random.Seed(1);
+        DataNode root;
+        root["Enemies"]["Killed"].SetData<int>(172, 0);
+        root["Player Deaths"].SetData<int>(3, 0);
+        const size_t entries = (size_t)megabytes * 1024 * 1024 / 64;
+        for(size_t i = 0; i < entries; i++)
+        {
+            DataNode& group = root["Group " + std::to_string(i / 64)];
+            DataNode& entry = group["Entry" + std::to_string(i % 64)];
+            entry.SetData<float>(random.Range(-1000.0f, 1000.0f), "x");
+            entry.SetData<float>(random.Range(-1000.0f, 1000.0f), "y");
+            entry.SetData<int>(i, "id");
+            if(i % 8 == 0)
+                entry["Label"].SetString("entry number " + std::to_string(i), 0);
+        }
+        Serialize(root, file);
+
+        MappedFile mapped;
+        if(!mapped.Open(file))
+        {
+            std::cout << "savebench: cannot open " << file << std::endl;
+            return 1;
+        }
+        const double size = mapped.size / (1024.0 * 1024.0);
+        mapped.Close();
+
+        DataNode loaded;
+        double best = 1e30, total = 0.0;
+        for(int run = 0; run < runs; run++)
+        {
+            const uint64_t begin = SDL_GetPerformanceCounter();
+            Deserialize(loaded, file);
+            const double time = (SDL_GetPerformanceCounter() - begin) * 1000.0 / SDL_GetPerformanceFrequency();
+            best = std::min(best, time);
+            total += time;
+        }
+        const bool equal = Equal(root, loaded);
+        std::remove(file.c_str());
+        std::cout << "savebench: " << size << " MB, " << Count(root) << " nodes, best " << best << " ms (" << size * 1000.0 / best << 
+        " MB/s), average " << total / runs << " ms over " << runs << " runs, round trip " << (equal ? "ok" : "MISMATCH") << std::endl;
+        return equal ? 0 : 1;
+    }
+};
 
-        player = {5.0f, Rect(60, 60, 30, 30, 0xFF00FF00), 20};
+class Game
+{
+private:
+    Simulation sim;
+    int local = 0;
+    Window window;
+    pSystem ps;
+    pData explosion;
+    pData kill;
+    std::vector<pEmitter> emitters;
+    Timestep timestep;
+    TaskThread simWorker;
+    Input input;
+    std::array<Input, MAX_PLAYERS> inputs = {};
+    InputLog inputLog;
+    Rewind rewind;
+    float snapshotTime = 0.0f;
+    std::string recordFile, replayFile;
+    bool raster = true;
+    std::optional<uint64_t> expect;
+    int checkpoint = -1;
+    bool stress = false;
+    NetServer server;
+    NetClient client;
+    NetState applied;
+    int hostPort = -1, players = 1;
+    std::string joinAddress;
+    GameState currentState;
+    Captures captures;
+    Idle idle;
+    Latch latch;
+    Button start, retry, home, stat, back;
+    int menuLayer, statsLayer, successLayer, failLayer;
+    SceneCache scene;
+    JobSystem jobs;
+    Random random;
+    DataNode savefile;
+public:
+    inline void Options(int argc, char** argv)
+    {
+        for(int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            if(arg == "--stress" && i + 1 < argc)
+            {
+                stress = true;
+                sim.enemyCount = std::clamp(atoi(argv[++i]), 1, 100000);
+            }
+            else if(arg == "--record" && i + 1 < argc)
+                recordFile = argv[++i];
+            else if(arg == "--replay" && i + 1 < argc)
+                replayFile = argv[++i];
+            else if(arg == "--expect" && i + 1 < argc)
+                expect = strtoull(argv[++i], nullptr, 16);
+            else if(arg == "--no-raster")
+                raster = false;
+            else if(arg == "--checkpoint" && i + 1 < argc)
+                checkpoint = std::max(atoi(argv[++i]), 0);
+            else if(arg == "--host" && i + 1 < argc)
+                hostPort = std::clamp(atoi(argv[++i]), 0, 65535);
+            else if(arg == "--players" && i + 1 < argc)
+                players = std::clamp(atoi(argv[++i]), 1, MAX_PLAYERS);
+            else if(arg == "--join" && i + 1 < argc)
+                joinAddress = argv[++i];
+        }
+    }
+    inline void Start()
+    {
+        currentState = GameState::MainMenu;
+        
+        window.Init("Window", 800, 600, !replayFile.empty());
+        SDL_AddEventWatch(Latch::Watch, &latch);
 
         ps = pSystem(0, 0);
 
@@ -423,28 +2898,47 @@ public:
         back.size = 5;
         stat.size = start.size = retry.size = home.size = 10;
 
+        RenderLayers();
+
+        sim.Create(v2i(3200, 2400), v2i(window.GetWidth(), window.GetHeight()));
+
+        scene.Create(window, sim.world.x, sim.world.y, 0xFFFFFF00);
+        scene.AddGroup([&](Window& window)
+        {
+            for(auto& s : sim.seeds)
+                window.DrawCircle(0xFFFF00FF, s.position.x, s.position.y, 3.0f);
+        });
+
         Deserialize(savefile, "datafile.txt");
 
-        stats.EnemiesKilled = GetData<int>(savefile.GetProperty("Enemies->Killed"), 0).value();
-        stats.EnemiesSpawned = GetData<int>(savefile.GetProperty("Enemies->Spawned"), 0).value();
-        stats.MissilesFired = GetData<int>(savefile.GetProperty("Missiles->Fired"), 0).value();
-        stats.MissilesHit = GetData<int>(savefile.GetProperty("Missiles->Hit"), 0).value();
-        stats.PlayerDeaths = GetData<int>(savefile.GetProperty("Player Deaths"), 0).value();
-        stats.SeedsCollected = GetData<int>(savefile.GetProperty("Seeds Collected"), 0).value();
+        sim.stats.EnemiesKilled = GetData<int>(savefile.GetProperty("Enemies->Killed"), 0).value();
+        sim.stats.EnemiesSpawned = GetData<int>(savefile.GetProperty("Enemies->Spawned"), 0).value();
+        sim.stats.MissilesFired = GetData<int>(savefile.GetProperty("Missiles->Fired"), 0).value();
+        sim.stats.MissilesHit = GetData<int>(savefile.GetProperty("Missiles->Hit"), 0).value();
+        sim.stats.PlayerDeaths = GetData<int>(savefile.GetProperty("Player Deaths"), 0).value();
+        sim.stats.SeedsCollected = GetData<int>(savefile.GetProperty("Seeds Collected"), 0).value();
         captures.count = GetData<int>(savefile.GetProperty("Captures->Count"), 0).value();
         captures.dir = GetString(savefile.GetProperty("Captures->Directory"), 0).value();
         captures.prefix = GetString(savefile.GetProperty("Captures->Prefix"), 0).value();
-
-        smoke.colors.push_back(0xFFD8D8D8);
-        smoke.colors.push_back(0xFFB1B1B1);
-        smoke.colors.push_back(0xFF7E7E7E);
-        smoke.colors.push_back(0xFF474747);
-        smoke.colors.push_back(0xFF1A1A1A);
-        smoke.colors.push_back(0xFFFFFFFF);
-        smoke.rect.ex = smoke.rect.sx = 0;
-        smoke.rect.ey = smoke.rect.sy = 0;
-        smoke.maxSpeed = 1;
-        smoke.minSpeed = 0;
+        ps.SetCapacity(GetData<int>(savefile.GetProperty("Particles->Capacity"), 0).value_or(ps.capacity), pOverflow::DropOldest);
+        random.Seed(GetData<int>(savefile.GetProperty("Random->Seed"), 0).value_or(time(0)));
+        ps.random = random.Split();
+        jobs.Start(std::max(GetData<int>(savefile.GetProperty("Jobs->Threads"), 0).value_or(std::thread::hardware_concurrency()) - 1, 0));
+        ps.jobs = &jobs;
+        window.resolution.dynamic = GetData<bool>(savefile.GetProperty("Resolution->Dynamic"), 0).value_or(false);
+        window.resolution.budget = GetData<float>(savefile.GetProperty("Resolution->Budget"), 0).value_or(window.resolution.budget);
+        ps.budget.adaptive = GetData<bool>(savefile.GetProperty("Particles->Adaptive"), 0).value_or(true);
+        timestep.step = 1.0 / std::max(GetData<int>(savefile.GetProperty("Timestep->Rate"), 0).value_or(60), 1);
+        timestep.maxSteps = std::max(GetData<int>(savefile.GetProperty("Timestep->MaxSteps"), 0).value_or(timestep.maxSteps), 1);
+        timestep.threaded = GetData<bool>(savefile.GetProperty("Timestep->Threaded"), 0).value_or(false);
+        if(timestep.threaded)
+            simWorker.Start();
+        rewind.Resize(std::max(GetData<int>(savefile.GetProperty("Rewind->Frames"), 0).value_or(600), 0));
+        rewind.budget = (size_t)std::max(GetData<int>(savefile.GetProperty("Rewind->Megabytes"), 0).value_or(64), 0) << 20;
+        idle.enabled = GetData<bool>(savefile.GetProperty("Menus->Idle"), 0).value_or(true);
+        idle.timeout = std::max(GetData<int>(savefile.GetProperty("Menus->Timeout"), 0).value_or(idle.timeout), 1);
+        latch.enabled = GetData<bool>(savefile.GetProperty("Input->Latch"), 0).value_or(true);
+        latch.margin = std::max(GetData<float>(savefile.GetProperty("Input->Margin"), 0).value_or(latch.margin), 0.0f);
 
         explosion.colors.push_back(0xFFD8D8D8);
         explosion.colors.push_back(0xFFB1B1B1);
@@ -477,95 +2971,89 @@ public:
 
         ps.pause = false;
 
-        player.cooldown = 0;
-
-        Restart();
-    }
-    inline void Restart()
-    {
-        for(auto& enemy : enemies)
+        if(hostPort >= 0)
         {
-            delete enemy.shape;
-            enemy.shape = nullptr;
+            if(!server.Host(hostPort, players, 1))
+                std::cout << "net: cannot host on port " << hostPort << std::endl;
         }
-        enemies.clear();
-        seeds.clear();
-        missiles.clear();
-        ps.particles.clear();
-        const int size = seeds.size();
-        for(int i = 0; i < 50 - size; i++)
+        if(!joinAddress.empty())
         {
-            seeds.push_back({
-                {
-                    rand(10.0f, window.GetWidth() - 10.0f),
-                    rand(10.0f, window.GetHeight() - 10.0f)
-                }, false
-            });
+            Address address;
+            if(Resolve(joinAddress, address) && client.Join(address))
+                currentState = GameState::GameLoop;
+            else
+                std::cout << "net: cannot join " << joinAddress << std::endl;
         }
-        player.cooldown = 0;
-        player.health = 20.0f;
-        player.rect.width = 30;
-        player.rect.height = 30;
-        player.velocity = 5.0f;
-        player.rect.position.x = 60.0f;
-        player.rect.position.y = 60.0f;
+
+        Restart(random.Next());
     }
-    inline void SpawnMissile(const v2f start, const v2f destination, uint32_t color, float distance_max)
+    inline void RenderLayers()
     {
-        Triangle tri;
-        equilateral(tri, 20);
-        tri.color = color;
-        v2f dist = destination - start;
-        tri.position = start;
-        missiles.push_back(Missile{
-            10.0f, tri, atan2(dist.y, dist.x),
-            0.0f, distance_max, false
-        });
+        const int w = window.GetWidth();
+        const int h = window.GetHeight();
+
+        menuLayer = window.CreateRenderTarget(w, h);
+        window.BindRenderTarget(menuLayer);
+        window.Clear(0xFFFFFFFF);
+        start.render(window);
+        stat.render(window);
+        window.DrawText({150, 40, 650, 92}, "SQUARE-IO", 0xFF00FF00);
+
+        successLayer = window.CreateRenderTarget(w, h);
+        window.BindRenderTarget(successLayer);
+        window.Clear(0xFFFFFFFF);
+        window.DrawText({200, 40, 600, 92}, "Wanna Replay?", 0xFF000000);
+        home.render(window);
+        retry.render(window);
+
+        failLayer = window.CreateRenderTarget(w, h);
+        window.BindRenderTarget(failLayer);
+        window.Clear(0xFFFFFFFF);
+        window.DrawText({250, 40, 550, 92}, "Try Again...", 0xFF000000);
+        retry.render(window);
+        home.render(window);
+
+        statsLayer = window.CreateRenderTarget(w, h);
+        window.BindRenderTarget(0);
     }
-    inline void ExplodeMissile(Missile& m)
+    inline void RenderStatsLayer()
     {
-        if(m.remove) return;
-        ps.position = m.triangle.position;
-        ps.Generate(explosion, 18, pMode::Normal,
-        pShape::Circle, pBehaviour::Directional,
-        -1.8f, 80.0f, 40);
-        m.remove = true;
+        std::string str;
+        str += "Enemies Killed: " + std::to_string(sim.stats.EnemiesKilled) + "\n";
+        str += "Enemies Spawned: " + std::to_string(sim.stats.EnemiesSpawned) + "\n";
+        str += "Missiles Fired: " + std::to_string(sim.stats.MissilesFired) + "\n";
+        str += "Missiles Hit: " + std::to_string(sim.stats.MissilesHit) + "\n";
+        str += "Seeds Collected: " + std::to_string(sim.stats.SeedsCollected) + "\n";
+        str += "Player Deaths: " + std::to_string(sim.stats.PlayerDeaths) + "\n";
+        window.BindRenderTarget(statsLayer);
+        window.Clear(0xFFFFFFFF);
+        back.render(window);
+        window.DrawText({300, 20, 500, 80}, "STATS", 0xFF000000);
+        window.DrawText({150, 100, 700, 550}, str, 0xFF000000);
+        window.BindRenderTarget(0);
     }
-    inline void SpawnEnemy(pShape shape, v2f start_pos)
+    inline void Restart(uint64_t seed)
     {
-        stats.EnemiesSpawned++;
-        uint32_t color = enemy_colors[rand(0, 8)];
-        enemies.push_back({
-            6.0f, nullptr,
-            20.0f, false, 
-            100, shape
-        });
-        switch(shape)
-        {
-            case pShape::Circle:
-            {
-                enemies.back().shape = new Circle(start_pos.x, start_pos.y, 10.0f, color);
-            }
-            break;
-            case pShape::Rect:
-            {
-                enemies.back().shape = new Rect(start_pos.x, start_pos.y, 20.0f, 20.0f, color);
-            }
-            break;
-            case pShape::Triangle:
-            {
-                const float m = 0.577350269f;
-                enemies.back().shape = new Triangle(v2f(0.0f, m * 20.0f), v2f(10.0f, -m * 20.0f), v2f(-10.0f, -m * 20.0f), start_pos, color);
-            }
-            break;
-        };
+        sim.Restart(seed);
+        ps.random = random.Split();
+        ps.Clear();
+        inputLog.seed = seed;
+        inputLog.enemies = sim.enemyCount;
+        inputLog.frames.clear();
+        rewind.Clear();
+        scene.Invalidate();
+        timestep.Reset();
+        server.Restart(seed);
     }
     inline void UpdateAndDraw(const uint8_t* keyboard, const Mouse& mouse)
     {
+        simWorker.Wait();
+        if(client.socket.open)
+            Receive();
         switch(currentState)
         {
             case GameState::MainMenu: MainMenu(keyboard, mouse); break;
-            case GameState::GameLoop: GameLoop(keyboard, mouse); break;
+            case GameState::GameLoop: idle.key = UINT32_MAX; GameLoop(keyboard, mouse); break;
             case GameState::EndSuccess: EndSuccess(keyboard, mouse); break;
             case GameState::EndFail: EndFail(keyboard, mouse); break;
             case GameState::Stats: StatsScreen(mouse); break;
@@ -575,18 +3063,15 @@ public:
     {
         if(start.clicked(mouse.x, mouse.y, mouse.buttons & SDL_BUTTON(1)))
         {
-            Restart();
+            Restart(random.Next());
             currentState = GameState::GameLoop;
         }
         if(stat.clicked(mouse.x, mouse.y, mouse.buttons & SDL_BUTTON(1)))
         {
+            RenderStatsLayer();
             currentState = GameState::Stats;
         }
-        window.Clear(0xFFFFFFFF);
-        start.render(window);
-        stat.render(window);
-        window.DrawText({150, 40, 650, 92}, "SQUARE-IO", 0xFF00FF00);
-        window.Present();
+        DrawMenu(menuLayer, mouse, {&start, &stat});
     }
     inline void StatsScreen(const Mouse& mouse)
     {
@@ -594,242 +3079,419 @@ public:
         {
             currentState = GameState::MainMenu;
         }
-        std::string str;
-        str += "Enemies Killed: " + std::to_string(stats.EnemiesKilled) + "\n";
-        str += "Enemies Spawned: " + std::to_string(stats.EnemiesSpawned) + "\n";
-        str += "Missiles Fired: " + std::to_string(stats.MissilesFired) + "\n";
-        str += "Missiles Hit: " + std::to_string(stats.MissilesHit) + "\n";
-        str += "Seeds Collected: " + std::to_string(stats.SeedsCollected) + "\n";
-        str += "Player Deaths: " + std::to_string(stats.PlayerDeaths) + "\n";
-        window.Clear(0xFFFFFFFF);
-        back.render(window);
-        window.DrawText({300, 20, 500, 80}, "STATS", 0xFF000000);
-        window.DrawText({150, 100, 700, 550}, str, 0xFF000000);
-        window.Present();
+        DrawMenu(statsLayer, mouse, {&back});
     }
     inline void EndSuccess(const uint8_t* keyboard, const Mouse& mouse)
     {
-        if(retry.clicked(mouse.x, mouse.y, mouse.buttons & SDL_BUTTON(1)))
+        if(!client.socket.open && retry.clicked(mouse.x, mouse.y, mouse.buttons & SDL_BUTTON(1)))
         {
-            Restart();
+            Restart(random.Next());
             currentState = GameState::GameLoop;
         }
-        if(home.clicked(mouse.x, mouse.y, mouse.buttons & SDL_BUTTON(1))) 
+        if(!client.socket.open && home.clicked(mouse.x, mouse.y, mouse.buttons & SDL_BUTTON(1))) 
             currentState = GameState::MainMenu;
-        window.Clear(0xFFFFFFFF);
-        window.DrawText({200, 40, 600, 92}, "Wanna Replay?", 0xFF000000);
-        home.render(window);
-        retry.render(window);
-        window.Present();
+        DrawMenu(successLayer, mouse, {&retry, &home});
     }
     inline void EndFail(const uint8_t* keyboard, const Mouse& mouse)
     {
-        if(retry.clicked(mouse.x, mouse.y, mouse.buttons & SDL_BUTTON(1)))
+        if(!client.socket.open && retry.clicked(mouse.x, mouse.y, mouse.buttons & SDL_BUTTON(1)))
         {
-            Restart();
+            Restart(random.Next());
             currentState = GameState::GameLoop;
         }
-        if(home.clicked(mouse.x, mouse.y, mouse.buttons & SDL_BUTTON(1))) 
+        if(!client.socket.open && home.clicked(mouse.x, mouse.y, mouse.buttons & SDL_BUTTON(1))) 
             currentState = GameState::MainMenu;
-        window.Clear(0xFFFFFFFF);
-        window.DrawText({250, 40, 550, 92}, "Try Again...", 0xFF000000);
-        retry.render(window);
-        home.render(window);
+        DrawMenu(failLayer, mouse, {&retry, &home});
+    }
+    inline void DrawMenu(int layer, const Mouse& mouse, std::initializer_list<Button*> buttons)
+    {
+        if(currentState == GameState::GameLoop)
+            return;
+        uint32_t key = (uint32_t)currentState << 8 | (mouse.buttons & 7);
+        int bit = 3;
+        for(Button* button : buttons)
+            key |= (uint32_t)button->hover(mouse.x, mouse.y) << bit++;
+        if(idle.enabled && key == idle.key)
+        {
+            idle.skipped++;
+            window.resolution.lastPresent = 0;
+            return;
+        }
+        const uint64_t begin = SDL_GetPerformanceCounter();
+        idle.key = key;
+        window.Composite(layer);
+        for(Button* button : buttons)
+        {
+            if(!button->hover(mouse.x, mouse.y)) continue;
+            const int w = button->image.width * button->size * 0.5f;
+            const int h = button->image.height * button->size * 0.5f;
+            window.DrawRectOutline(0xFFFFFFFF, button->position.x - w, button->position.y - h, button->position.x + w, button->position.y + h);
+        }
         window.Present();
+        idle.drawn++;
+        idle.drawTime += (SDL_GetPerformanceCounter() - begin) * 1000.0 / SDL_GetPerformanceFrequency();
     }
-    inline void GameLoop(const uint8_t* keyboard, const Mouse& mouse)
+    inline bool Idling()
+    {
+        return idle.enabled && idle.key != UINT32_MAX && currentState != GameState::GameLoop && !client.socket.open && !server.socket.open;
+    }
+    inline void Handle(const SDL_Event& e)
     {
-        while(enemies.size() < 4)
+        switch (e.type) 
         {
-            SpawnEnemy((pShape)rand(0, 3), 
-            {
-                rand(0.0f, (float)window.GetWidth()),
-                rand(0.0f, (float)window.GetHeight())
-            });
+            case SDL_QUIT:
+                window.shouldClose = true;
+            break;
+            case SDL_WINDOWEVENT:
+                idle.key = UINT32_MAX;
+            break;
         }
-
-        player.cooldown--;
-
-        if(keyboard[SDL_SCANCODE_W] && player.rect.position.y - player.rect.height * 0.5 - player.velocity > 0) 
-            player.rect.position.y -= player.velocity;
-        if(keyboard[SDL_SCANCODE_S] && player.rect.position.y + player.rect.height * 0.5 + player.velocity < window.GetHeight())
-            player.rect.position.y += player.velocity;
-        if(keyboard[SDL_SCANCODE_A] && player.rect.position.x - player.rect.width * 0.5 - player.velocity > 0)
-            player.rect.position.x -= player.velocity;
-        if(keyboard[SDL_SCANCODE_D] && player.rect.position.x + player.rect.width * 0.5 + player.velocity < window.GetWidth()) 
-            player.rect.position.x += player.velocity;
-
-        ps.Update(8);
-
-        if(player.cooldown <= 0 && (mouse.buttons & SDL_BUTTON(1)))
+    }
+    inline void GameLoop(const uint8_t* keyboard, const Mouse& mouse)
+    {
+        std::copy_n(keyboard, input.keys.size(), input.keys.begin());
+        input.mouse = mouse;
+        input.aim = v2f(mouse.x, mouse.y) + window.camera.position;
+        if(client.socket.open)
         {
-            SpawnMissile(player.rect.position, v2f(mouse.x, mouse.y), 0xFF0000FF, 600.0f);
-            player.cooldown = 20;
+            RenderGame(keyboard);
+            window.Present();
+            return;
         }
-
-        for(auto& m : missiles)
+        if(rewind.Capacity() > 0 && !server.socket.open)
         {
-            stats.MissilesFired++;
-            ps.position = m.triangle.position;
-            ps.Generate(smoke, 6, pMode::Normal, pShape::Pixel,
-            pBehaviour::Directional, 0.0f, 0.0f, 10);
-            m.triangle.position.x += cos(m.angle) * m.velocity;
-            m.triangle.position.y += sin(m.angle) * m.velocity;
-            m.triangle.SetRotation(m.angle - pi * 0.5f);
-            m.distance_current += m.velocity;
-            float expRadius = 1.0f;
-
-            if(m.distance_current > m.distance_max)
-            {
-                expRadius = 2.5f;
-                ExplodeMissile(m);
-            }
-
-            if(m.triangle.color == 0xFFFF0000 && std::hypot(m.triangle.position.x - player.rect.position.x,
-                m.triangle.position.y - player.rect.position.y) < player.rect.width * 0.6 * expRadius)
+            if(keyboard[SDL_SCANCODE_BACKSPACE])
             {
-                player.health -= 2;
-                ExplodeMissile(m);
+                if(rewind.count > 0)
+                {
+                    Snapshot& snapshot = rewind.Pop();
+                    sim.Restore(snapshot);
+                    inputLog.frames.resize(snapshot.frame);
+                    scene.Invalidate();
+                }
+                timestep.Reset();
+                RenderGame(keyboard);
+                window.Present();
+                return;
             }
-
-            if(m.triangle.color == 0xFF0000FF)
-                for(auto& enemy : enemies)
-                    if(std::hypot(m.triangle.position.x - enemy.shape->position.x,
-                        m.triangle.position.y - enemy.shape->position.y) < 30 * expRadius)
-                    {
-                        stats.MissilesHit++;
-                        enemy.health -= 10;
-                        ExplodeMissile(m);
-                    }
+            const uint64_t start = SDL_GetPerformanceCounter();
+            Snapshot& snapshot = rewind.Push();
+            sim.Save(snapshot);
+            snapshot.frame = inputLog.frames.size();
+            snapshotTime = (SDL_GetPerformanceCounter() - start) * 1000000.0f / SDL_GetPerformanceFrequency();
         }
-
-        for(auto& enemy : enemies){
-            float x = player.rect.position.x - enemy.shape->position.x;
-            float y = player.rect.position.y - enemy.shape->position.y;
-            float dist = std::hypot(x, y);
-            float angle = atan2(y, x);
-            enemy.shape->SetRotation(angle - pi * 0.5);
-            
-            if(dist > 400.0f)
-            {
-                enemy.shape->position.x += cos(angle) * enemy.velocity;
-                enemy.shape->position.y += sin(angle) * enemy.velocity;
-            }
-            
-            if(dist <= 400.0f && enemy.cooldown <= 0)
-            {
-                SpawnMissile(enemy.shape->position, player.rect.position, 0xFFFF0000, 350.0f);
-                enemy.cooldown = 150;
-            }
-            
-            enemy.cooldown--;
-            
-            if(enemy.health <= 0)
-            {
-                stats.EnemiesKilled++;
-                kill.colors[0] = enemy.shape->color;
-                ps.position = enemy.shape->position;
-                ps.Generate(kill, 15, pMode::Normal, enemy.data,
-                pBehaviour::Directional, 0.0f, 70.0f, 65);
-                enemy.remove = true;
-                delete enemy.shape;
-                enemy.shape = nullptr;
-            }
+        if(timestep.threaded)
+        {
+            RenderGame(keyboard);
+            const int steps = timestep.Advance();
+            if(!recordFile.empty()) inputLog.Record(input, steps);
+            simWorker.Post([this, steps]{Simulate(steps);});
         }
-
-        for(auto& s : seeds)
+        else
         {
-            if(s.position.x < player.rect.position.x + player.rect.width * 0.5 &&
-            s.position.x > player.rect.position.x - player.rect.width * 0.5 && 
-            s.position.y < player.rect.position.y + player.rect.height * 0.5 &&
-            s.position.y > player.rect.position.y - player.rect.height * 0.5 && !s.remove)
-            {
-                player.rect.width += 2.5f;
-                player.rect.height += 2.5f;
-                player.velocity += 0.01f;
-                stats.SeedsCollected++;
-                s.remove = true;
-            }
+            const int steps = timestep.Advance();
+            if(!recordFile.empty()) inputLog.Record(input, steps);
+            Simulate(steps);
+            RenderGame(keyboard);
         }
-
-        if(seeds.empty())
-            currentState = GameState::EndSuccess;
-
-        if(player.health <= 0.0f)
+        window.Present();
+    }
+    inline void Simulate(int steps)
+    {
+        const uint64_t start = SDL_GetPerformanceCounter();
+        for(int i = 0; i < steps && sim.outcome == Outcome::Playing; i++)
         {
+            inputs[local] = input;
+            server.Poll(inputs.data());
+            while(sim.playerCount < server.firstRemote + (int)server.peers.size())
+                sim.Spawn(sim.playerCount++);
+            sim.Step(inputs.data());
+            Effects();
+            ps.Update(8);
+            if(server.socket.open)
+                server.Broadcast(sim);
+        }
+        if(sim.outcome == Outcome::Success)
+            currentState = GameState::EndSuccess;
+        if(sim.outcome == Outcome::Fail)
             currentState = GameState::EndFail;
-            stats.PlayerDeaths++;
+        timestep.simTime = (SDL_GetPerformanceCounter() - start) * 1000.0f / SDL_GetPerformanceFrequency();
+    }
+    inline void Receive()
+    {
+        client.Send(input);
+        if(!client.Poll()) return;
+        const NetState& state = client.State();
+        if(applied.tick == 0 || state.round != applied.round)
+        {
+            sim.playerCount = state.playerCount;
+            Restart(state.round);
+            applied = NetState();
         }
+        NetApply(state, applied, sim);
+        applied = state;
+        local = client.index;
+        timestep.alpha = 1.0f;
+        Effects();
+        ps.Update(8);
+        if(sim.outcome == Outcome::Playing)
+            currentState = GameState::GameLoop;
+        if(sim.outcome == Outcome::Success)
+            currentState = GameState::EndSuccess;
+        if(sim.outcome == Outcome::Fail)
+            currentState = GameState::EndFail;
+    }
+    inline void Effects()
+    {
+        const Events& events = sim.events;
+        emitters.clear();
+        for(auto& e : events.explosions)
+            emitters.push_back({e.position, pShape::Circle, 0});
+        ps.Generate(explosion, emitters.data(), emitters.size(), 18, pMode::Normal,
+        pBehaviour::Directional, -1.8f, 80.0f, 40, pPriority::Gameplay);
+
+        emitters.clear();
+        for(auto& e : events.kills)
+            emitters.push_back({e.position, e.shape, e.color});
+        ps.Generate(kill, emitters.data(), emitters.size(), 15, pMode::Normal,
+        pBehaviour::Directional, 0.0f, 70.0f, 65, pPriority::Gameplay);
+
+        for(auto& e : events.pickups)
+            scene.Invalidate({e.position.x - 4.0f, e.position.y - 4.0f, e.position.x + 4.0f, e.position.y + 4.0f});
+    }
+    inline void RenderGame(const uint8_t* keyboard)
+    {
+        const float alpha = timestep.alpha;
+        const Player& player = sim.players[local];
+        const v2f position = lerp(player.previous, player.rect.position, alpha);
+        window.camera.position.x = floor(std::clamp(position.x - window.GetWidth() * 0.5f, 0.0f, (float)(sim.world.x - window.GetWidth())));
+        window.camera.position.y = floor(std::clamp(position.y - window.GetHeight() * 0.5f, 0.0f, (float)(sim.world.y - window.GetHeight())));
 
-        enemies.erase(std::remove_if(enemies.begin(), enemies.end(), [](Enemy& e){return e.remove;}), enemies.end());
-        missiles.erase(std::remove_if(missiles.begin(), missiles.end(), [](Missile& m){return m.remove;}), missiles.end());
-        seeds.erase(std::remove_if(seeds.begin(), seeds.end(), [](seed& s){return s.remove;}), seeds.end());
-
-        window.Clear(0xFFFFFF00);
+        scene.Update(window);
+        scene.Restore(window, window.camera.position.x, window.camera.position.y);
 
-        for(auto& s : seeds)
-            window.DrawCircle(0xFFFF00FF, s.position.x, s.position.y, 3.0f);
+        window.camera.enabled = true;
 
         ps.Draw(window);
 
-        for(auto& enemy : enemies)
-            enemy.shape->Draw(window);
+        sim.enemies.ForEach([&](auto& shape, Enemy& enemy, EnemyHandle handle)
+        {
+            auto frame = shape;
+            frame.position = lerp(enemy.previous, shape.position, alpha);
+            frame.Draw(window);
+        });
+
+        for(auto& missile : sim.missiles)
+        {
+            missile.trail.Draw(window, 0xFFD8D8D8, 0xFF474747, 3);
+            Triangle frame = missile.triangle;
+            frame.position = lerp(missile.previous, missile.triangle.position, alpha);
+            frame.Draw(window);
+        }
 
-        for(auto& missile : missiles)
-            missile.triangle.Draw(window);
+        for(int i = 0; i < sim.playerCount; i++)
+        {
+            if(!sim.Alive(i)) continue;
+            Rect frame = sim.players[i].rect;
+            frame.position = lerp(sim.players[i].previous, sim.players[i].rect.position, alpha);
+            frame.Draw(window);
+        }
 
-        player.rect.Draw(window);
+        window.camera.enabled = false;
 
         window.DrawText(10, 10, "HEALTH:" + std::to_string(player.health), 2);
 
-        window.DrawText({650, 10, 790, 36}, "SEEDS:" + std::to_string(seeds.size()));
+        window.DrawText({650, 10, 790, 36}, "SEEDS:" + std::to_string(sim.seeds.size()));
 
-        window.Present();
+        Resolution& resolution = window.resolution;
+        ps.budget.Update(resolution, ps.Count());
+        resolution.hold = !ps.budget.Settled(resolution);
+
+        if(keyboard[SDL_SCANCODE_F3])
+        {
+            const Resolution& res = window.resolution;
+            window.DrawText(10, 570, "SCALE:" + std::to_string(res.scale).substr(0, 5) + 
+            " CPU:" + std::to_string(res.frameTime).substr(0, 5) + "ms" +
+            " AVG:" + std::to_string(res.averageFrameTime).substr(0, 5) + "ms" + 
+            " BUDGET:" + std::to_string(res.budget).substr(0, 5) + "ms");
+            pBudget& budget = ps.budget;
+            window.DrawText(10, 550, "PARTICLES:" + std::to_string(budget.live) + 
+            " LOD:" + std::to_string(budget.level).substr(0, 5) +
+            " SIM:" + std::to_string(budget.updateTime).substr(0, 5) + "ms" +
+            " DRAW:" + std::to_string(budget.drawTime).substr(0, 5) + "ms" +
+            " CULLED:" + std::to_string(budget.Culled(pPriority::Gameplay)) + "/" + std::to_string(budget.Culled(pPriority::Cosmetic)));
+            window.DrawText(10, 530, "ENEMIES:" + std::to_string(sim.enemies.Size()) + 
+            " STEER:" + std::to_string(sim.steerTime).substr(0, 5) + "ms");
+            window.DrawText(10, 510, "STEPS:" + std::to_string(timestep.steps) + 
+            " ALPHA:" + std::to_string(timestep.alpha).substr(0, 4) +
+            " FRAME:" + std::to_string(timestep.averageInterval).substr(0, 5) + "ms" +
+            " JITTER:" + std::to_string(timestep.jitter).substr(0, 5) + "ms" +
+            " SIM:" + std::to_string(timestep.simTime).substr(0, 5) + "ms" +
+            " DROPPED:" + std::to_string(timestep.dropped));
+            window.DrawText(10, 490, "REWIND:" + std::to_string(rewind.count) + "/" + std::to_string(rewind.Capacity()) + 
+            " SNAPSHOT:" + std::to_string(rewind.count ? rewind.ring[(rewind.head - 1 + rewind.Capacity()) % rewind.Capacity()].data.size() / 1024 : 0) + "KB" +
+            " SAVE:" + std::to_string(snapshotTime).substr(0, 5) + "us");
+        }
+    }
+    inline int Replay()
+    {
+        InputLog log;
+        if(!log.Load(replayFile))
+        {
+            std::cout << "replay: cannot read " << replayFile << std::endl;
+            return 1;
+        }
+        ps.budget.adaptive = false;
+        window.resolution.dynamic = false;
+        sim.enemyCount = log.enemies;
+        Restart(log.seed);
+        currentState = GameState::GameLoop;
+        uint64_t steps = 0;
+        size_t frames = 0;
+        Snapshot snapshot;
+        float saveTime = 0.0f;
+        const uint64_t start = SDL_GetPerformanceCounter();
+        for(; frames < log.frames.size() && currentState == GameState::GameLoop; frames++)
+        {
+            if((int)frames == checkpoint)
+            {
+                const uint64_t begin = SDL_GetPerformanceCounter();
+                sim.Save(snapshot);
+                saveTime = (SDL_GetPerformanceCounter() - begin) * 1000000.0f / SDL_GetPerformanceFrequency();
+                snapshot.frame = frames;
+            }
+            log.Apply(log.frames[frames], input);
+            Simulate(log.frames[frames].steps);
+            steps += log.frames[frames].steps;
+            if(raster)
+            {
+                RenderGame(input.keys.data());
+                window.Present();
+            }
+        }
+        const double elapsed = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+        const uint64_t checksum = sim.Checksum();
+        std::cout << "replay: " << frames << " frames, " << steps << " steps, " << elapsed << " ms (" 
+        << (steps ? elapsed * 1000.0 / steps : 0.0) << " us/step), checksum " << std::hex << checksum << std::dec << std::endl;
+        if(expect && *expect != checksum)
+        {
+            std::cout << "replay: expected " << std::hex << *expect << std::dec << std::endl;
+            return 1;
+        }
+        if(checkpoint >= 0 && (size_t)checkpoint < frames)
+        {
+            const uint64_t begin = SDL_GetPerformanceCounter();
+            sim.Restore(snapshot);
+            const float restoreTime = (SDL_GetPerformanceCounter() - begin) * 1000000.0f / SDL_GetPerformanceFrequency();
+            currentState = GameState::GameLoop;
+            for(size_t i = snapshot.frame; i < frames; i++)
+            {
+                log.Apply(log.frames[i], input);
+                Simulate(log.frames[i].steps);
+            }
+            const uint64_t resumed = sim.Checksum();
+            std::cout << "replay: checkpoint at frame " << snapshot.frame << ", " << snapshot.data.size() << " bytes, save " << saveTime << 
+            " us, restore " << restoreTime << " us, resumed checksum " << std::hex << resumed << std::dec << std::endl;
+            if(resumed != checksum)
+                return 1;
+        }
+        return 0;
     }
-    inline void Loop()
+    inline int Loop()
     {
+        if(!replayFile.empty())
+            return Replay();
         while (!window.shouldClose) 
         {
+            simWorker.Wait();
             SDL_Event e;
-            while (SDL_PollEvent(&e))
+            const bool playing = currentState == GameState::GameLoop;
+            if(Idling())
             {
-                switch (e.type) 
-                {
-                    case SDL_QUIT:
-                        window.shouldClose = true;
-                    break;
-                }
+                const uint64_t begin = SDL_GetPerformanceCounter();
+                if(SDL_WaitEventTimeout(&e, idle.timeout))
+                    Handle(e);
+                idle.sleepTime += (double)(SDL_GetPerformanceCounter() - begin) / SDL_GetPerformanceFrequency();
             }
+            else if(playing)
+                latch.Wait(window.resolution);
+            while (SDL_PollEvent(&e))
+                Handle(e);
+            latch.Sample();
+            window.resolution.frameStart = latch.sampled;
 
             Mouse mouse;
             const uint8_t* keyboard = SDL_GetKeyboardState(NULL);
             mouse.buttons = SDL_GetMouseState(&mouse.x, &mouse.y);
             if(keyboard[SDL_SCANCODE_P])
                 TakeScreenShot(window, captures.dir + captures.prefix + std::to_string(captures.count++) + ".png");
+            const uint64_t presented = window.resolution.lastPresent;
             UpdateAndDraw(keyboard, mouse);
+            if(playing && window.resolution.lastPresent != presented)
+                latch.Presented(window.resolution);
         }
+        simWorker.Wait();
+        return 0;
     }
     inline void End()
     {
-        savefile["Enemies"]["Killed"].SetData<int>(stats.EnemiesKilled, 0);
-        savefile["Enemies"]["Spawned"].SetData<int>(stats.EnemiesSpawned, 0);
-        savefile["Missiles"]["Fired"].SetData<int>(stats.MissilesFired, 0);
-        savefile["Missiles"]["Hit"].SetData<int>(stats.MissilesHit, 0);
-        savefile["Player Deaths"].SetData<int>(stats.PlayerDeaths, 0);
-        savefile["Seeds Collected"].SetData<int>(stats.SeedsCollected, 0);
+        SDL_DelEventWatch(Latch::Watch, &latch);
+        savefile["Enemies"]["Killed"].SetData<int>(sim.stats.EnemiesKilled, 0);
+        savefile["Enemies"]["Spawned"].SetData<int>(sim.stats.EnemiesSpawned, 0);
+        savefile["Missiles"]["Fired"].SetData<int>(sim.stats.MissilesFired, 0);
+        savefile["Missiles"]["Hit"].SetData<int>(sim.stats.MissilesHit, 0);
+        savefile["Player Deaths"].SetData<int>(sim.stats.PlayerDeaths, 0);
+        savefile["Seeds Collected"].SetData<int>(sim.stats.SeedsCollected, 0);
         savefile["Captures"]["Count"].SetData<int>(captures.count, 0);
         savefile["Captures"]["Directory"].SetString(captures.dir, 0);
         savefile["Captures"]["Prefix"].SetString(captures.prefix, 0);
-        Serialize(savefile, "datafile.txt");
-        window.~Window();
+        savefile["Resolution"]["Dynamic"].SetData<bool>(window.resolution.dynamic, 0);
+        savefile["Resolution"]["Budget"].SetData<float>(window.resolution.budget, 0);
+        savefile["Particles"]["Capacity"].SetData<int>(ps.capacity, 0);
+        savefile["Particles"]["Adaptive"].SetData<bool>(ps.budget.adaptive, 0);
+        savefile["Jobs"]["Threads"].SetData<int>(jobs.Threads(), 0);
+        savefile["Timestep"]["Rate"].SetData<int>((int)std::lround(1.0 / timestep.step), 0);
+        savefile["Timestep"]["MaxSteps"].SetData<int>(timestep.maxSteps, 0);
+        savefile["Timestep"]["Threaded"].SetData<bool>(timestep.threaded, 0);
+        savefile["Rewind"]["Frames"].SetData<int>(rewind.Capacity(), 0);
+        savefile["Rewind"]["Megabytes"].SetData<int>(rewind.budget >> 20, 0);
+        savefile["Menus"]["Idle"].SetData<bool>(idle.enabled, 0);
+        savefile["Menus"]["Timeout"].SetData<int>(idle.timeout, 0);
+        savefile["Input"]["Latch"].SetData<bool>(latch.enabled, 0);
+        savefile["Input"]["Margin"].SetData<float>(latch.margin, 0);
+        if(replayFile.empty())
+            Serialize(savefile, "datafile.txt");
+        if(!recordFile.empty() && !server.socket.open && !client.socket.open)
+            inputLog.Save(recordFile);
+        simWorker.Stop();
+        jobs.Stop();
+        if(stress && sim.steerFrames > 0)
+            std::cout << "stress: " << sim.enemyCount << " enemies, steering " << sim.steerTotal / sim.steerFrames << " ms/frame over " << sim.steerFrames << " frames" << std::endl;
+        if(idle.skipped > 0)
+            std::cout << "menus: " << idle.drawn << " frames drawn, " << idle.skipped << " skipped, " << (idle.drawn ? idle.drawTime / idle.drawn : 0.0) << 
+            " ms/draw, " << idle.sleepTime << " s asleep" << std::endl;
+        if(latch.frames > 0)
+            std::cout << "input: " << latch.frames << " frames, event-to-present at most " << (latch.events ? latch.latency / latch.events : 0.0) << " ms avg, " << latch.worst << 
+            " ms max over " << latch.events << " events, sample-to-present " << latch.sampleLatency / latch.frames << " ms avg, " << latch.missed << " missed, work " << 
+            latch.work << " ms, latched " << (latch.enabled ? "on" : "off") << " (" << latch.slept << " s waited), " << latch.dropped << " dropped" << std::endl;
     }
 };
 
 int main(int argc, char** argv) 
 {
+    Batch batch;
+    if(batch.Options(argc, argv))
+        return batch.Run();
+    NetBench bench;
+    if(bench.Options(argc, argv))
+        return bench.Run();
+    SaveBench save;
+    if(save.Options(argc, argv))
+        return save.Run();
     Game instance;
+    instance.Options(argc, argv);
     instance.Start();
-    instance.Loop();
+    const int result = instance.Loop();
     instance.End();
-    return 0;
+    return result;
 }
\ No newline at end of file
@@ -3,14 +3,63 @@
 
 #include "includes.h"
 
+struct fixed
+{
+    int32_t raw;
+    fixed() = default;
+    constexpr fixed(int value) : raw(value * 65536) {}
+    constexpr fixed(double value) : raw((int32_t)(value * 65536.0 + (value < 0.0 ? -0.5 : 0.5))) {}
+    constexpr fixed(float value) : fixed((double)value) {}
+    static constexpr fixed Raw(int32_t raw)
+    {
+        fixed result = 0;
+        result.raw = raw;
+        return result;
+    }
+    explicit constexpr operator float() const {return raw * (1.0f / 65536.0f);}
+    explicit constexpr operator int() const {return raw >> 16;}
+    friend constexpr fixed operator+(fixed a, fixed b) {return Raw(a.raw + b.raw);}
+    friend constexpr fixed operator-(fixed a, fixed b) {return Raw(a.raw - b.raw);}
+    friend constexpr fixed operator-(fixed a) {return Raw(-a.raw);}
+    friend constexpr fixed operator*(fixed a, fixed b) {return Raw(((int64_t)a.raw * b.raw) >> 16);}
+    friend constexpr fixed operator/(fixed a, fixed b)
+    {
+        if(b.raw == 0) return Raw(a.raw < 0 ? INT32_MIN : INT32_MAX);
+        return Raw((int64_t)a.raw * 65536 / b.raw);
+    }
+    inline fixed& operator+=(fixed other) {return *this = *this + other;}
+    inline fixed& operator-=(fixed other) {return *this = *this - other;}
+    inline fixed& operator*=(fixed other) {return *this = *this * other;}
+    inline fixed& operator/=(fixed other) {return *this = *this / other;}
+    friend constexpr bool operator==(fixed a, fixed b) {return a.raw == b.raw;}
+    friend constexpr bool operator!=(fixed a, fixed b) {return a.raw != b.raw;}
+    friend constexpr bool operator<(fixed a, fixed b) {return a.raw < b.raw;}
+    friend constexpr bool operator>(fixed a, fixed b) {return a.raw > b.raw;}
+    friend constexpr bool operator<=(fixed a, fixed b) {return a.raw <= b.raw;}
+    friend constexpr bool operator>=(fixed a, fixed b) {return a.raw >= b.raw;}
+};
+
+fixed sin(fixed angle);
+fixed cos(fixed angle);
+fixed atan2(fixed y, fixed x);
+fixed sqrt(fixed value);
+fixed hypot(fixed x, fixed y);
+
+#if defined FIXED_POINT
+typedef fixed real;
+#else
+typedef float real;
+#endif
+
 template <class T> struct Vector2D
 {
-    static_assert(std::is_arithmetic_v<T>);
+    static_assert(std::is_arithmetic_v<T> || std::is_same_v<T, fixed>);
     T x, y;
     inline Vector2D() = default;
     inline Vector2D(const T _v) : x(_v), y(_v) {}
-    inline Vector2D(const Vector2D<T>& v2d) : x(v2d.x), y(v2d.y) {}
+    inline Vector2D(const Vector2D<T>& v2d) = default;
     inline Vector2D(const T _x, const T _y) : x(_x), y(_y) {}
+    template <class F> explicit inline Vector2D(const Vector2D<F>& v2d) : x(T(v2d.x)), y(T(v2d.y)) {}
     inline Vector2D& operator=(const Vector2D& v2d) = default;
     inline friend void operator*=(Vector2D& v2d, const T _v) 
     {
@@ -64,11 +113,6 @@ template <class T> struct Vector2D
     {
         return Vector2D<T>(-v2d.x, -v2d.y);
     }
-    template <class F> inline operator Vector2D<F>()
-    {
-        x = static_cast<F>(x);
-        y = static_cast<F>(y);
-    }
     inline std::array<T, 2> data()
     {
         return {x, y};
@@ -78,6 +122,8 @@ template <class T> struct Vector2D
 typedef Vector2D<float> v2f;
 typedef Vector2D<double> v2d;
 typedef Vector2D<int> v2i;
+typedef Vector2D<fixed> v2x;
+typedef Vector2D<real> v2r;
 
 template <class T, std::size_t size> inline T dot(std::array<T, size> a, std::array<T, size> b){
     T result = T(0);
@@ -264,11 +310,34 @@ inline v2f rotate(float angle, v2f v)
     );
 }
 
-template <class T> inline T rand(T min, T max)
+inline v2f lerp(v2f a, v2f b, float t)
 {
-    return ((float)rand() / (float)RAND_MAX) * (max - min) + min;
+    return a + (b - a) * t;
 }
 
+inline v2f rotate(v2f direction, v2f v)
+{
+    return v2f(
+        direction.x * v.x - direction.y * v.y,
+        direction.y * v.x + direction.x * v.y
+    );
+}
+
+struct Random
+{
+    uint64_t state[4];
+    alignas(32) uint32_t lanes[4][8];
+    Random(uint64_t seed = 0);
+    void Seed(uint64_t seed);
+    Random Split();
+    uint64_t Next();
+    float Float();
+    int Range(int min, int max);
+    float Range(float min, float max);
+    fixed Range(fixed min, fixed max);
+    void Fill(float* out, int count, float min = 0.0f, float max = 1.0f);
+};
+
 struct Transform{
     matrix3x3f transform;
     matrix3x3f inverted;
@@ -289,6 +358,226 @@ struct Transform{
 #ifdef MATH_H
 #undef MATH_H
 
+Random::Random(uint64_t seed)
+{
+    Seed(seed);
+}
+
+void Random::Seed(uint64_t seed)
+{
+    auto splitmix = [&]()
+    {
+        uint64_t z = (seed += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    };
+    for(auto& s : state)
+        s = splitmix();
+    for(int l = 0; l < 8; l++)
+    {
+        const uint64_t a = splitmix(), b = splitmix();
+        lanes[0][l] = a; lanes[1][l] = a >> 32;
+        lanes[2][l] = b; lanes[3][l] = b >> 32;
+    }
+}
+
+Random Random::Split()
+{
+    return Random(Next());
+}
+
+uint64_t Random::Next()
+{
+    auto rotl = [](uint64_t x, int k) {return (x << k) | (x >> (64 - k));};
+    const uint64_t result = rotl(state[1] * 5, 7) * 9;
+    const uint64_t t = state[1] << 17;
+    state[2] ^= state[0];
+    state[3] ^= state[1];
+    state[1] ^= state[2];
+    state[0] ^= state[3];
+    state[2] ^= t;
+    state[3] = rotl(state[3], 45);
+    return result;
+}
+
+float Random::Float()
+{
+    return (Next() >> 40) * (1.0f / 16777216.0f);
+}
+
+int Random::Range(int min, int max)
+{
+    if(max <= min) return min;
+    return std::min(min + (int)(Float() * (max - min)), max - 1);
+}
+
+float Random::Range(float min, float max)
+{
+    return Float() * (max - min) + min;
+}
+
+fixed Random::Range(fixed min, fixed max)
+{
+    return fixed::Raw(min.raw + (int32_t)(((Next() >> 32) * (uint64_t)(max.raw - min.raw)) >> 32));
+}
+
+void Random::Fill(float* out, int count, float min, float max)
+{
+    const float scale = (max - min) * (1.0f / 16777216.0f);
+    int i = 0;
+#if defined __AVX2__
+    __m256i s0 = _mm256_load_si256((const __m256i*)lanes[0]);
+    __m256i s1 = _mm256_load_si256((const __m256i*)lanes[1]);
+    __m256i s2 = _mm256_load_si256((const __m256i*)lanes[2]);
+    __m256i s3 = _mm256_load_si256((const __m256i*)lanes[3]);
+    const __m256 vscale = _mm256_set1_ps(scale), vmin = _mm256_set1_ps(min);
+    for(; i + 8 <= count; i += 8)
+    {
+        const __m256i result = _mm256_add_epi32(s0, s3);
+        const __m256i t = _mm256_slli_epi32(s1, 9);
+        s2 = _mm256_xor_si256(s2, s0);
+        s3 = _mm256_xor_si256(s3, s1);
+        s1 = _mm256_xor_si256(s1, s2);
+        s0 = _mm256_xor_si256(s0, s3);
+        s2 = _mm256_xor_si256(s2, t);
+        s3 = _mm256_or_si256(_mm256_slli_epi32(s3, 11), _mm256_srli_epi32(s3, 21));
+        const __m256 u = _mm256_cvtepi32_ps(_mm256_srli_epi32(result, 8));
+#if defined __FMA__
+        _mm256_storeu_ps(out + i, _mm256_fmadd_ps(u, vscale, vmin));
+#else
+        _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_mul_ps(u, vscale), vmin));
+#endif
+    }
+    _mm256_store_si256((__m256i*)lanes[0], s0);
+    _mm256_store_si256((__m256i*)lanes[1], s1);
+    _mm256_store_si256((__m256i*)lanes[2], s2);
+    _mm256_store_si256((__m256i*)lanes[3], s3);
+#endif
+    for(; i < count; i += 8)
+    {
+        float block[8];
+        for(int l = 0; l < 8; l++)
+        {
+            const uint32_t result = lanes[0][l] + lanes[3][l];
+            const uint32_t t = lanes[1][l] << 9;
+            lanes[2][l] ^= lanes[0][l];
+            lanes[3][l] ^= lanes[1][l];
+            lanes[1][l] ^= lanes[2][l];
+            lanes[0][l] ^= lanes[3][l];
+            lanes[2][l] ^= t;
+            lanes[3][l] = (lanes[3][l] << 11) | (lanes[3][l] >> 21);
+#if defined __FMA__
+            block[l] = std::fma((float)(result >> 8), scale, min);
+#else
+            block[l] = (float)(result >> 8) * scale + min;
+#endif
+        }
+        std::copy_n(block, std::min(8, count - i), out + i);
+    }
+}
+
+static const std::array<int32_t, 1025>& SineTable()
+{
+    static const std::array<int32_t, 1025> table = []
+    {
+        std::array<int32_t, 1025> table;
+        for(int k = 0; k <= 256; k++)
+        {
+            const int64_t x = (int64_t)k * 1686629713 / 256;
+            const int64_t x2 = (x * x) >> 30;
+            int64_t term = x, sum = x;
+            for(int n = 1; n < 8; n++)
+            {
+                term = -((term * x2) >> 30) / (2 * n * (2 * n + 1));
+                sum += term;
+            }
+            table[k] = (sum + (1 << 13)) >> 14;
+        }
+        for(int k = 257; k <= 512; k++)
+            table[k] = table[512 - k];
+        for(int k = 513; k <= 1024; k++)
+            table[k] = -table[k - 512];
+        return table;
+    }();
+    return table;
+}
+
+static fixed Sine(int64_t phase)
+{
+    const std::array<int32_t, 1025>& table = SineTable();
+    const int index = (phase >> 16) & 1023;
+    const int32_t a = table[index], b = table[index + 1];
+    return fixed::Raw(a + (int32_t)(((int64_t)(b - a) * (phase & 0xFFFF)) >> 16));
+}
+
+static uint64_t SquareRoot(uint64_t value)
+{
+    uint64_t result = std::sqrt((double)value);
+    while(result * result > value)
+        result--;
+    while((result + 1) * (result + 1) <= value)
+        result++;
+    return result;
+}
+
+fixed sin(fixed angle)
+{
+    return Sine(((int64_t)angle.raw * 10680707) >> 16);
+}
+
+fixed cos(fixed angle)
+{
+    return Sine((((int64_t)angle.raw * 10680707) >> 16) + (256 << 16));
+}
+
+fixed atan2(fixed y, fixed x)
+{
+    static constexpr int64_t steps[30] = {
+        843314857, 497837829, 263043837, 133525159, 67021687, 33543516, 16775851, 8388437, 4194283, 2097149,
+        1048576, 524288, 262144, 131072, 65536, 32768, 16384, 8192, 4096, 2048, 1024, 512, 256, 128, 64, 32, 16, 8, 4, 2
+    };
+    if(x.raw == 0 && y.raw == 0) return 0;
+    int64_t vx = x.raw, vy = y.raw, angle = 0;
+    if(vx < 0)
+    {
+        angle = vy >= 0 ? 3373259426ll : -3373259426ll;
+        vx = -vx;
+        vy = -vy;
+    }
+    vx *= 1 << 24;
+    vy *= 1 << 24;
+    for(int i = 0; i < 30; i++)
+    {
+        const int64_t dx = vx >> i, dy = vy >> i;
+        if(vy > 0)
+        {
+            vx += dy;
+            vy -= dx;
+            angle += steps[i];
+        }
+        else
+        {
+            vx -= dy;
+            vy += dx;
+            angle -= steps[i];
+        }
+    }
+    return fixed::Raw((angle + (1 << 13)) >> 14);
+}
+
+fixed sqrt(fixed value)
+{
+    if(value.raw <= 0) return 0;
+    return fixed::Raw(SquareRoot((uint64_t)value.raw << 16));
+}
+
+fixed hypot(fixed x, fixed y)
+{
+    const uint64_t length = SquareRoot((uint64_t)((int64_t)x.raw * x.raw) + (uint64_t)((int64_t)y.raw * y.raw));
+    return fixed::Raw(std::min<uint64_t>(length, INT32_MAX));
+}
+
 Transform::Transform()
 {
     this->Reset();
@@ -0,0 +1,249 @@
+#ifndef NET_H
+#define NET_H
+
+#include "includes.h"
+
+#if defined _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#undef DrawText
+#undef near
+#undef far
+#if defined _MSC_VER
+#pragma comment(lib, "ws2_32.lib")
+#endif
+typedef SOCKET socket_t;
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+typedef int socket_t;
+#endif
+
+#define PACKET_CAPACITY 65000
+
+struct Address
+{
+    uint32_t host = 0;
+    uint16_t port = 0;
+    inline bool operator==(const Address& other) const {return host == other.host && port == other.port;}
+    inline bool operator!=(const Address& other) const {return !(*this == other);}
+};
+
+bool Resolve(const std::string& text, Address& address);
+
+struct Socket
+{
+    socket_t handle;
+    bool open = false;
+    Socket() = default;
+    Socket(const Socket&) = delete;
+    Socket& operator=(const Socket&) = delete;
+    bool Open(uint16_t port);
+    void Close();
+    uint16_t Port();
+    bool Send(const Address& to, const void* data, int size);
+    int Receive(Address& from, void* data, int capacity);
+    ~Socket()
+    {
+        Close();
+    }
+};
+
+struct BitWriter
+{
+    std::vector<uint8_t> bytes;
+    uint64_t scratch = 0;
+    int bits = 0;
+    void Reset();
+    void Write(uint32_t value, int count);
+    void WritePacked(uint32_t value);
+    void WriteSigned(int32_t value);
+    void Flush();
+    inline int Size() {return bytes.size();}
+};
+
+struct BitReader
+{
+    const uint8_t* data;
+    int size, cursor = 0;
+    uint64_t scratch = 0;
+    int bits = 0;
+    bool overflow = false;
+    BitReader(const uint8_t* data, int size) : data(data), size(size) {}
+    uint32_t Read(int count);
+    uint32_t ReadPacked();
+    int32_t ReadSigned();
+};
+
+#endif
+
+#ifdef NET_H
+#undef NET_H
+
+bool Resolve(const std::string& text, Address& address)
+{
+    const size_t colon = text.rfind(':');
+    const std::string host = colon == std::string::npos ? text : text.substr(0, colon);
+    in_addr parsed;
+    if(inet_pton(AF_INET, host.c_str(), &parsed) != 1) return false;
+    address.host = ntohl(parsed.s_addr);
+    address.port = colon == std::string::npos ? 0 : atoi(text.c_str() + colon + 1);
+    return true;
+}
+
+bool Socket::Open(uint16_t port)
+{
+    Close();
+#if defined _WIN32
+    WSADATA data;
+    WSAStartup(MAKEWORD(2, 2), &data);
+#endif
+    handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+#if defined _WIN32
+    if(handle == INVALID_SOCKET) return false;
+#else
+    if(handle < 0) return false;
+#endif
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if(bind(handle, (const sockaddr*)&address, sizeof(address)) != 0)
+    {
+        open = true;
+        Close();
+        return false;
+    }
+    const int buffer = 1 << 20;
+    setsockopt(handle, SOL_SOCKET, SO_RCVBUF, (const char*)&buffer, sizeof(buffer));
+    setsockopt(handle, SOL_SOCKET, SO_SNDBUF, (const char*)&buffer, sizeof(buffer));
+#if defined _WIN32
+    u_long nonBlocking = 1;
+    ioctlsocket(handle, FIONBIO, &nonBlocking);
+#else
+    fcntl(handle, F_SETFL, fcntl(handle, F_GETFL, 0) | O_NONBLOCK);
+#endif
+    open = true;
+    return true;
+}
+
+void Socket::Close()
+{
+    if(!open) return;
+#if defined _WIN32
+    closesocket(handle);
+    WSACleanup();
+#else
+    close(handle);
+#endif
+    open = false;
+}
+
+uint16_t Socket::Port()
+{
+    sockaddr_in address = {};
+    socklen_t length = sizeof(address);
+    getsockname(handle, (sockaddr*)&address, &length);
+    return ntohs(address.sin_port);
+}
+
+bool Socket::Send(const Address& to, const void* data, int size)
+{
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(to.host);
+    address.sin_port = htons(to.port);
+    return sendto(handle, (const char*)data, size, 0, (const sockaddr*)&address, sizeof(address)) == size;
+}
+
+int Socket::Receive(Address& from, void* data, int capacity)
+{
+    sockaddr_in address = {};
+    socklen_t length = sizeof(address);
+    const int size = recvfrom(handle, (char*)data, capacity, 0, (sockaddr*)&address, &length);
+    if(size <= 0) return -1;
+    from.host = ntohl(address.sin_addr.s_addr);
+    from.port = ntohs(address.sin_port);
+    return size;
+}
+
+void BitWriter::Reset()
+{
+    bytes.clear();
+    scratch = 0;
+    bits = 0;
+}
+
+void BitWriter::Write(uint32_t value, int count)
+{
+    scratch |= (uint64_t)(value & (uint32_t)((1ull << count) - 1)) << bits;
+    bits += count;
+    while(bits >= 8)
+    {
+        bytes.push_back(scratch & 0xFF);
+        scratch >>= 8;
+        bits -= 8;
+    }
+}
+
+void BitWriter::WritePacked(uint32_t value)
+{
+    if(value < (1u << 4)) {Write(0, 2); Write(value, 4);}
+    else if(value < (1u << 8)) {Write(1, 2); Write(value, 8);}
+    else if(value < (1u << 16)) {Write(2, 2); Write(value, 16);}
+    else {Write(3, 2); Write(value, 32);}
+}
+
+void BitWriter::WriteSigned(int32_t value)
+{
+    WritePacked(((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+}
+
+void BitWriter::Flush()
+{
+    if(bits > 0)
+        bytes.push_back(scratch & 0xFF);
+    scratch = 0;
+    bits = 0;
+}
+
+uint32_t BitReader::Read(int count)
+{
+    while(bits < count)
+    {
+        if(cursor >= size)
+        {
+            overflow = true;
+            return 0;
+        }
+        scratch |= (uint64_t)data[cursor++] << bits;
+        bits += 8;
+    }
+    const uint32_t value = scratch & ((1ull << count) - 1);
+    scratch >>= count;
+    bits -= count;
+    return value;
+}
+
+uint32_t BitReader::ReadPacked()
+{
+    static constexpr int widths[4] = {4, 8, 16, 32};
+    return Read(widths[Read(2)]);
+}
+
+int32_t BitReader::ReadSigned()
+{
+    const uint32_t value = ReadPacked();
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+#endif
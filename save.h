@@ -3,6 +3,13 @@
 
 #include "includes.h"
 
+#if !defined _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 const std::string whitespaces = " \n\t\v\0";
 const std::string seperator = "->";
 
@@ -67,7 +74,7 @@ struct DataNode
     void SetString(const std::string& str, std::size_t index = 0);
     void SetString(const std::string& str, std::string name = "");
     bool HasProperty(const std::string dir);
-    void SetData(const std::string str);
+    void SetData(std::string_view str);
     const std::string GetData() const;
     void ClearData();
     DataNode& operator[](const std::string& str);
@@ -115,63 +122,106 @@ inline void Serialize(DataNode& node, const std::string& file)
     output.close();
 }
 
-inline void Deserialize(std::reference_wrapper<DataNode> node, const std::string& file)
+struct MappedFile
+{
+    const char* data = nullptr;
+    std::size_t size = 0;
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    bool Open(const std::string& file);
+    void Close();
+    inline std::string_view View() const {return std::string_view(data, size);}
+    ~MappedFile()
+    {
+        Close();
+    }
+private:
+    bool mapped = false;
+    std::string buffer;
+};
+
+inline void Parse(std::reference_wrapper<DataNode> node, std::string_view text)
 {
     node.get().ClearData();
-    std::stack<std::pair<std::reference_wrapper<DataNode>, std::string>> stack;
+    std::vector<std::pair<const std::string, DataNode>*> stack;
+    std::string scratch, name;
+    std::size_t index = 0;
 
-    auto Trim = [&](const std::string& str) -> std::string
+    auto Space = [](char c) -> bool {return whitespaces.find(c) != std::string::npos;};
+    auto Plain = [&](char c, char terminator) -> bool {return c != terminator && c != '[' && !Space(c);};
+    auto Token = [&](char terminator) -> std::optional<std::string_view>
     {
-        std::string res;
-        for(std::size_t index = 0; index < str.size(); ++index)
-            if(str[index] == '[')
+        std::size_t begin = index;
+        while(index < text.size() && Plain(text[index], terminator)) index++;
+        if(index >= text.size()) return std::nullopt;
+        if(text[index] == terminator) return text.substr(begin, index++ - begin);
+        scratch.assign(text.substr(begin, index - begin));
+        while(index < text.size() && text[index] != terminator)
+        {
+            if(text[index] == '[')
             {
-                std::size_t end = str.find_first_of(']', ++index);
-                res += str.substr(index, end - index);
-                index = end;
+                const std::size_t end = text.find(']', index + 1);
+                if(end == std::string_view::npos) return std::nullopt;
+                scratch.append(text.substr(index + 1, end - index - 1));
+                index = end + 1;
             }
-            else if(whitespaces.find(str[index]) == std::string::npos)
-                res += str[index];
-        return res;
+            else if(Space(text[index]))
+                index++;
+            else
+            {
+                begin = index;
+                while(index < text.size() && Plain(text[index], terminator)) index++;
+                scratch.append(text.substr(begin, index - begin));
+            }
+        }
+        if(index >= text.size()) return std::nullopt;
+        index++;
+        return std::string_view(scratch);
     };
 
-    std::ifstream input(file.c_str());
-    std::stringstream content;
-    content << input.rdbuf();
-    content.str(Trim(content.str()));
-    input.close();
-
-    std::string buffer;
-    for(int index = 0; index < content.str().size(); index++)
+    while(index < text.size())
     {
-        if(content.str()[index] == '<')
+        const char c = text[index++];
+        if(c == '[')
         {
-            std::size_t end = content.str().find_first_of('>', ++index);
-            bool close = content.str()[index] == '/';
-            index += (close ? 1 : 0);
-            buffer += content.str().substr(index, end - index);
-            index = end;
-            if(!close)
+            const std::size_t end = text.find(']', index);
+            if(end == std::string_view::npos) return;
+            index = end + 1;
+        }
+        else if(c == '<')
+        {
+            const std::optional<std::string_view> token = Token('>');
+            if(!token.has_value()) return;
+            if(!token.value().empty() && token.value()[0] == '/')
             {
-                std::reference_wrapper<DataNode> newNode = stack.empty() ? node.get()[buffer] : stack.top().first.get()[buffer];
-                stack.push(std::make_pair(newNode, buffer));
+                if(!stack.empty() && stack.back()->first == token.value().substr(1))
+                    stack.pop_back();
             }
-            else if(stack.top().second == buffer)
+            else
             {
-                stack.pop();
+                DataNode& parent = stack.empty() ? node.get() : stack.back()->second;
+                name.assign(token.value());
+                stack.push_back(&*parent.nodes.try_emplace(name).first);
             }
-            buffer.clear();
         }
-        else if(content.str()[index] == '{')
+        else if(c == '{')
         {
-            std::size_t end = content.str().find_first_of('}', ++index);
-            buffer += content.str().substr(index, end - index);
-            stack.top().first.get().SetData(buffer);
-            buffer.clear();
+            const std::optional<std::string_view> token = Token('}');
+            if(!token.has_value()) return;
+            // Serialize writes root data before the first tag, so it is read back into the root node.
+            (stack.empty() ? node.get() : stack.back()->second).SetData(token.value());
         }
     }
 }
 
+inline void Deserialize(std::reference_wrapper<DataNode> node, const std::string& file)
+{
+    MappedFile input;
+    input.Open(file);
+    Parse(node, input.View());
+}
+
 inline std::optional<std::string> GetString(std::optional<DataNode> datanode, std::size_t index = 0)
 {
 #if defined NO_COLLISIONS
@@ -290,37 +340,89 @@ void DataNode::ClearData()
     nodes.clear();
 }
 
-void DataNode::SetData(const std::string str)
+void DataNode::SetData(std::string_view str)
 {
     data.clear();
-    int index = 0;
+    std::size_t index = 0;
     Container buffer;
     while(index < str.size())
     {
         if(str[index] == '(')
         {
-            std::size_t end = str.find_first_of(')', ++index);
-            if(end == std::string::npos)
-                continue;
-            else
-            {
-                buffer.name = str.substr(index, end - index);
-                index = end;
-            }
+            const std::size_t end = str.find(')', index + 1);
+            if(end == std::string_view::npos)
+                break;
+            buffer.name = std::string(str.substr(index + 1, end - index - 1));
+            index = end + 1;
+            continue;
         }
-        else if(index == str.size() - 1 || str[index] == ',')
+        const std::size_t end = str.find_first_of("(,", index);
+        if(end == std::string_view::npos || (end == str.size() - 1 && str[end] == ','))
         {
-            if(index == str.size() - 1) buffer.content += str[index];
-            data.push_back(buffer);
-            buffer.content.clear();
-            buffer.name.reset();
+            buffer.content.append(str.substr(index));
+            data.push_back(std::move(buffer));
+            return;
+        }
+        buffer.content.append(str.substr(index, end - index));
+        index = end;
+        if(str[index] == ',')
+        {
+            data.push_back(std::move(buffer));
+            buffer = Container();
+            index++;
         }
-        else
-            buffer.content += str[index];
-        index++;
     }
 }
 
+bool MappedFile::Open(const std::string& file)
+{
+    Close();
+#if defined _WIN32
+    std::ifstream input(file.c_str(), std::ios::binary | std::ios::ate);
+    if(!input) return false;
+    buffer.resize(input.tellg());
+    input.seekg(0);
+    input.read(buffer.data(), buffer.size());
+    data = buffer.data();
+    size = buffer.size();
+#else
+    const int handle = open(file.c_str(), O_RDONLY);
+    if(handle < 0) return false;
+    struct stat info;
+    if(fstat(handle, &info) != 0)
+    {
+        close(handle);
+        return false;
+    }
+    if(info.st_size > 0)
+    {
+        void* view = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, handle, 0);
+        if(view == MAP_FAILED)
+        {
+            close(handle);
+            return false;
+        }
+        data = (const char*)view;
+        size = info.st_size;
+        mapped = true;
+    }
+    close(handle);
+#endif
+    return true;
+}
+
+void MappedFile::Close()
+{
+#if !defined _WIN32
+    if(mapped)
+        munmap((void*)data, size);
+#endif
+    mapped = false;
+    data = nullptr;
+    size = 0;
+    buffer.clear();
+}
+
 const std::string DataNode::GetData() const
 {
     std::string res;